@@ -1,5 +1,6 @@
 #include "audio.hpp"
 #include "../debug/log.hpp"
+#include "../debug/trace.hpp"
 #include <algorithm>
 #include <cmath>
 #include <mutex>
@@ -8,8 +9,8 @@
 #include <spa/param/route.h>
 #include <spa/pod/builder.h>
 #include <spa/pod/iter.h>
+#include <cerrno>
 #include <spa/utils/json.h>
-#include <unistd.h>
 
 const struct pw_registry_events registry_events = {
     PW_VERSION_REGISTRY_EVENTS,
@@ -17,6 +18,15 @@ const struct pw_registry_events registry_events = {
     /* global_remove */ AudioManagerClient::registryEventGlobalRemove,
 };
 
+static const struct pw_core_events core_events = {
+    .version = PW_VERSION_CORE_EVENTS,
+    .done = AudioManagerClient::coreDone,
+    .error = AudioManagerClient::coreError,
+};
+
+// how long to wait for PipeWire to answer before carrying on with what we have
+static constexpr std::chrono::milliseconds SYNC_TIMEOUT{500};
+
 static const struct pw_metadata_events metadata_events = {
     PW_VERSION_METADATA_EVENTS,
     /* property */ AudioManagerClient::metadataProperty,
@@ -40,6 +50,7 @@ AudioManagerClient::AudioManagerClient()
     , active_sink_channels(2)
     , cached_volume(-1.0f)
     , cached_mute(false) {
+    debug::trace::Span span("PipeWire connect");
     pw_init(nullptr, nullptr);
 
     loop = pw_thread_loop_new("audio-manager", nullptr);
@@ -67,11 +78,17 @@ AudioManagerClient::AudioManagerClient()
         return;
     }
 
+    pw_core_add_listener(core, &core_listener, &core_events, this);
     registry = pw_core_get_registry(core, PW_VERSION_REGISTRY, 0);
     pw_registry_add_listener(registry, &registry_listener, &registry_events, this);
     pw_thread_loop_unlock(loop);
 
-    usleep(150000);
+    // the first sync returns once every global was announced, the second once the
+    // default metadata bound from those has sent its properties (the default devices)
+    debug::trace::Span syncSpan("PipeWire sync");
+    if (!sync(SYNC_TIMEOUT) || !sync(SYNC_TIMEOUT)) {
+        debug::log(WARN, "PipeWire did not answer within {}ms", SYNC_TIMEOUT.count());
+    }
     initialized = true;
 }
 
@@ -92,6 +109,9 @@ AudioManagerClient::~AudioManagerClient() {
         spa_hook_remove(&metadata_listener);
         pw_proxy_destroy(metadata_proxy);
     }
+    if (core) {
+        spa_hook_remove(&core_listener);
+    }
     if (registry) {
         spa_hook_remove(&registry_listener);
         pw_proxy_destroy((struct pw_proxy*)registry);
@@ -108,6 +128,43 @@ AudioManagerClient::~AudioManagerClient() {
     pw_deinit();
 }
 
+bool AudioManagerClient::sync(std::chrono::milliseconds timeout) {
+    if (!core) {
+        return false;
+    }
+    pw_thread_loop_lock(loop);
+    int seq = pw_core_sync(core, PW_ID_CORE, 0);
+    pw_thread_loop_unlock(loop);
+
+    std::unique_lock<std::mutex> lock(ready_mutex);
+    return ready_cv.wait_for(lock, timeout, [&] { return done_seq >= seq || core_failed; }) && !core_failed;
+}
+
+void AudioManagerClient::coreDone(void* data, uint32_t id, int seq) {
+    auto* self = static_cast<AudioManagerClient*>(data);
+    if (id != PW_ID_CORE) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(self->ready_mutex);
+        self->done_seq = seq;
+    }
+    self->ready_cv.notify_all();
+}
+
+void AudioManagerClient::coreError(void* data, uint32_t id, int /*seq*/, int res, const char* message) {
+    auto* self = static_cast<AudioManagerClient*>(data);
+    debug::log(ERR, "PipeWire error on {}: {} ({})", id, message ? message : "", strerror(-res));
+    // a broken connection will never answer a sync, don't keep anyone waiting for it
+    if (id == PW_ID_CORE && res == -EPIPE) {
+        {
+            std::lock_guard<std::mutex> lock(self->ready_mutex);
+            self->core_failed = true;
+        }
+        self->ready_cv.notify_all();
+    }
+}
+
 void AudioManagerClient::teardownActiveDevice() {
     if (active_device_proxy) {
         spa_hook_remove(&active_device_listener);
@@ -161,6 +218,8 @@ void AudioManagerClient::updateActiveSinkNode() {
                 if (id != SPA_PARAM_Props) {
                     return;
                 }
+                debug::trace::setThreadName("pipewire");
+                debug::trace::Span span("pw sink props");
 
                 float volume = -1.0f;
                 bool mute = false;
@@ -192,14 +251,17 @@ void AudioManagerClient::updateActiveSinkNode() {
                 }
 
                 if (found_vol || found_mute) {
-                    std::lock_guard<std::mutex> lock(self->volume_mutex);
-                    if (found_vol) {
-                        self->cached_volume = std::pow(volume, 1.0f / 3.0f);
-                        self->active_sink_channels = channels;
-                    }
-                    if (found_mute) {
-                        self->cached_mute = mute;
+                    {
+                        std::lock_guard<std::mutex> lock(self->volume_mutex);
+                        if (found_vol) {
+                            self->cached_volume = std::pow(volume, 1.0f / 3.0f);
+                            self->active_sink_channels = channels;
+                        }
+                        if (found_mute) {
+                            self->cached_mute = mute;
+                        }
                     }
+                    self->volume_cv.notify_all();
                 }
             }};
         pw_node_add_listener(active_sink_node, &sink_node_listener, &node_events, this);
@@ -285,6 +347,8 @@ void AudioManagerClient::registryEventGlobal(void* data,
                                              uint32_t /*version*/,
                                              const struct spa_dict* props) {
     auto* self = static_cast<AudioManagerClient*>(data);
+    debug::trace::setThreadName("pipewire");
+    debug::trace::Span span("pw registry global");
 
     if (strcmp(type, PW_TYPE_INTERFACE_Node) == 0) {
         const char* media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
@@ -349,6 +413,8 @@ void AudioManagerClient::registryEventGlobalRemove(void* data, uint32_t id) {
 int AudioManagerClient::metadataProperty(
     void* data, uint32_t /*id*/, const char* key, const char* /*type*/, const char* value) {
     auto* self = static_cast<AudioManagerClient*>(data);
+    debug::trace::setThreadName("pipewire");
+    debug::trace::Span span("pw metadata");
     if (!key)
         return 0;
 
@@ -534,10 +600,7 @@ bool AudioManagerClient::setMute(bool mute) {
 void AudioManagerClient::updateDevices() {
     if (!initialized)
         return;
-    pw_thread_loop_lock(loop);
-    pw_core_sync(core, 0, 0);
-    pw_thread_loop_unlock(loop);
-    usleep(50000);
+    sync(SYNC_TIMEOUT);
 }
 
 std::vector<AudioDevice> AudioManagerClient::getDevices(const std::map<uint32_t, AudioDevice>& deviceMap) {
@@ -608,3 +671,18 @@ AudioManagerClient::VolumeInfo AudioManagerClient::getVolume() {
 }
 
 uint32_t AudioManagerClient::getDefaultSinkId() const { return default_sink_id; }
+
+bool AudioManagerClient::waitForVolume(std::chrono::milliseconds timeout) {
+    if (!loop) {
+        return false;
+    }
+    pw_thread_loop_lock(loop);
+    bool hasSink = active_sink_node != nullptr;
+    pw_thread_loop_unlock(loop);
+    if (!hasSink) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(volume_mutex);
+    return volume_cv.wait_for(lock, timeout, [&] { return cached_volume >= 0.0f; });
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <map>
 #include <mutex>
 #include <pipewire/extensions/metadata.h>
@@ -32,12 +34,24 @@ public:
     bool setDefaultOutput(uint32_t deviceId);
     uint32_t getDefaultSinkId() const;
 
+    // block until the default sink has reported its volume, false on timeout or when
+    // there is no default sink
+    bool waitForVolume(std::chrono::milliseconds timeout);
+
 private:
     struct pw_thread_loop* loop;
     struct pw_context* context;
     struct pw_core* core;
     struct pw_registry* registry;
     struct spa_hook registry_listener;
+    struct spa_hook core_listener{};
+
+    // readiness: pw_core "done" events for our syncs, and the sink's first Props
+    std::mutex ready_mutex;
+    std::condition_variable ready_cv;
+    int done_seq = -1;
+    bool core_failed = false;
+    std::condition_variable volume_cv;
 
     struct pw_proxy* metadata_proxy;
     struct pw_metadata* metadata;
@@ -65,6 +79,7 @@ private:
     bool cached_mute = false;
     mutable std::mutex volume_mutex;
 
+    bool sync(std::chrono::milliseconds timeout);
     void updateDevices();
     std::vector<AudioDevice> getDevices(const std::map<uint32_t, AudioDevice>& deviceMap);
     bool setDefault(uint32_t deviceId, const std::string& key);
@@ -89,5 +104,7 @@ public:
                                     uint32_t version,
                                     const struct spa_dict* props);
     static void registryEventGlobalRemove(void* data, uint32_t id);
+    static void coreDone(void* data, uint32_t id, int seq);
+    static void coreError(void* data, uint32_t id, int seq, int res, const char* message);
     static int metadataProperty(void* data, uint32_t id, const char* key, const char* type, const char* value);
 };
@@ -0,0 +1,28 @@
+#include "compositor.hpp"
+
+namespace compositor {
+
+    CompositorSnapshot Compositor::snapshot(unsigned parts) {
+        CompositorSnapshot snap;
+        if (parts & SNAPSHOT_CURSOR) {
+            snap.cursor = cursorPos();
+        }
+        if (parts & SNAPSHOT_MONITORS) {
+            // the interface only hands out the monitor under a point
+            if (auto m = monitorAtCursor(snap.cursor)) {
+                snap.monitors.push_back(*m);
+            }
+        }
+        if (parts & SNAPSHOT_WORKSPACES) {
+            snap.workspaces = getWorkspaces();
+        }
+        if (parts & SNAPSHOT_CLIENTS) {
+            snap.clients = getClients();
+        }
+        if (parts & SNAPSHOT_ACTIVE_WORKSPACE) {
+            snap.activeWorkspaceId = getActiveWorkspaceId();
+        }
+        return snap;
+    }
+
+} // namespace compositor
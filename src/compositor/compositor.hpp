@@ -40,6 +40,44 @@ namespace compositor {
         bool focused;
     };
 
+    // the parts of the compositor's state a mode needs, fetched together by snapshot()
+    enum SnapshotPart : unsigned {
+        SNAPSHOT_CURSOR = 1 << 0,
+        SNAPSHOT_MONITORS = 1 << 1,
+        SNAPSHOT_WORKSPACES = 1 << 2,
+        SNAPSHOT_CLIENTS = 1 << 3,
+        SNAPSHOT_ACTIVE_WORKSPACE = 1 << 4,
+
+        // where to open a popup, and what --overview draws
+        SNAPSHOT_PLACEMENT = SNAPSHOT_CURSOR | SNAPSHOT_MONITORS,
+        SNAPSHOT_OVERVIEW = SNAPSHOT_WORKSPACES | SNAPSHOT_CLIENTS | SNAPSHOT_ACTIVE_WORKSPACE,
+    };
+
+    // only the requested parts are filled in
+    struct CompositorSnapshot {
+        Vec2 cursor{0, 0};
+        std::vector<Monitor> monitors;
+        std::vector<Workspace> workspaces;
+        std::vector<Client> clients;
+        int activeWorkspaceId = -1;
+
+        std::optional<Monitor> monitorAt(const Vec2& pos) const {
+            for (const auto& m : monitors) {
+                if (pos.x >= m.x && pos.x < m.x + m.width && pos.y >= m.y && pos.y < m.y + m.height) {
+                    return m;
+                }
+            }
+            return std::nullopt;
+        }
+    };
+
+    // how a preloadWallpaper() went
+    enum class Preload {
+        Loaded,      // in memory, setWallpaper only has to switch to it
+        Sent,        // asked for but not confirmed: refused, or still decoding. unload it all the same
+        Unsupported, // the compositor can't preload (no hyprpaper socket), nothing to unload
+    };
+
     // What hyprwat needs from a compositor. Only cursorPos/monitorAtCursor are used by every
     // mode; the rest serve --overview and --wallpaper.
     class Compositor {
@@ -55,7 +93,21 @@ namespace compositor {
         virtual int getActiveWorkspaceId() = 0;
         virtual void dispatchWorkspace(int id) = 0;
 
-        virtual void setWallpaper(const std::string& path) = 0;
+        // the requested SnapshotParts in as few round trips as the compositor allows. the
+        // default asks for each part separately
+        virtual CompositorSnapshot snapshot(unsigned parts);
+
+        // on the named monitor, or on every monitor when it is empty
+        virtual void setWallpaper(const std::string& path, const std::string& monitor) = 0;
+
+        // load a wallpaper the user might pick before they do, so setWallpaper only has
+        // to switch to it
+        virtual Preload preloadWallpaper(const std::string& path) { return Preload::Unsupported; }
+        virtual void unloadWallpaper(const std::string& path) {}
+
+        // anything dispatchWorkspace/setWallpaper would otherwise find out on first use.
+        // called off the critical path by modes that dispatch, and once by the daemon
+        virtual void prepareDispatch() {}
 
         // --overview needs a per-window capture protocol; not every compositor has one
         virtual bool supportsOverview() const = 0;
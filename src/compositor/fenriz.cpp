@@ -1,8 +1,10 @@
 #include "fenriz.hpp"
 #include "../debug/log.hpp"
-#include <yaml-cpp/yaml.h>
+#include "../debug/trace.hpp"
+#include "json.hpp"
 
 #include <cstring>
+#include <poll.h>
 #include <stdexcept>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -19,7 +21,7 @@ namespace compositor {
     }
 
     static int connectSocket(const std::string& socketPath) {
-        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
         if (fd < 0)
             throw std::runtime_error("Failed to create socket");
 
@@ -34,95 +36,295 @@ namespace compositor {
         return fd;
     }
 
-    // fenriz sends the snapshot on accept, freshly built, so one read is all a one-shot
-    // client needs.
-    static std::string readSnapshotLine(const std::string& socketPath) {
-        int fd = connectSocket(socketPath);
+    void NdjsonLines::append(const char* data, size_t size) {
+        // drop what was handed out before it piles up, not on every read
+        if (start > 0 && start == buf.size()) {
+            buf.clear();
+            start = 0;
+        } else if (start > 4096 && start > buf.size() / 2) {
+            buf.erase(0, start);
+            start = 0;
+        }
+        buf.append(data, size);
+    }
+
+    bool NdjsonLines::next(std::string& line) {
+        while (start < buf.size()) {
+            size_t nl = buf.find('\n', start);
+            if (nl == std::string::npos) {
+                return false;
+            }
+            size_t end = nl;
+            if (end > start && buf[end - 1] == '\r') {
+                --end;
+            }
+            size_t from = start;
+            start = nl + 1;
+            if (end > from) {
+                line.assign(buf, from, end - from);
+                return true;
+            }
+        }
+        return false;
+    }
 
+    std::string NdjsonLines::take() {
+        std::string rest = buf.substr(start);
+        buf.clear();
+        start = 0;
+        return rest;
+    }
+
+    // the next line off fd; false at EOF
+    static bool readLine(int fd, NdjsonLines& lines, std::string& line) {
         char buf[4096];
-        std::string line;
-        while (true) {
+        while (!lines.next(line)) {
             ssize_t n = read(fd, buf, sizeof(buf));
             if (n < 0) {
-                close(fd);
                 throw std::runtime_error("Failed to read fenriz snapshot");
             }
-            if (n == 0)
-                break; // EOF before a newline: take what we have and let the parser complain
-            line.append(buf, n);
-            size_t nl = line.find('\n');
-            if (nl != std::string::npos) {
-                line.resize(nl);
-                break;
+            if (n == 0) {
+                return false;
             }
+            lines.append(buf, n);
         }
+        return true;
+    }
 
+    // fenriz sends the snapshot on accept, freshly built, so one read is all a one-shot
+    // client needs.
+    static std::string readSnapshotLine(const std::string& socketPath) {
+        int fd = connectSocket(socketPath);
+        NdjsonLines lines;
+        std::string line;
+        try {
+            if (!readLine(fd, lines, line)) {
+                line = lines.take(); // EOF before a newline: let the parser complain
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
         close(fd);
         return line;
     }
 
-    // JSON is a YAML 1.2 subset, so yaml-cpp parses it -- same trick used for hyprctl output.
+    static void parseOutput(json::Reader& r, Monitor& m) {
+        r.beginObject();
+        std::string_view key;
+        while (r.nextKey(key)) {
+            if (key == "name")
+                r.readString(m.name);
+            else if (key == "x")
+                r.readInt(m.x);
+            else if (key == "y")
+                r.readInt(m.y);
+            else if (key == "width")
+                r.readInt(m.width);
+            else if (key == "height")
+                r.readInt(m.height);
+            else if (key == "scale")
+                r.readFloat(m.scale);
+            else if (key == "focused")
+                r.readBool(m.focused);
+            else
+                r.skip();
+        }
+    }
+
     FenrizSnapshot parseFenrizSnapshot(const std::string& line) {
         FenrizSnapshot snap;
-        auto node = YAML::Load(line);
-
-        if (node["cursor"]) {
-            snap.cursor = {node["cursor"]["x"].as<float>(), node["cursor"]["y"].as<float>()};
-            snap.hasCursor = true;
-        }
-
-        if (node["outputs"] && node["outputs"].IsSequence()) {
-            int id = 0;
-            for (const auto& o : node["outputs"]) {
-                Monitor m;
-                m.id = id++; // fenriz keys outputs by name; index is a stable-enough stand-in
-                m.name = o["name"].as<std::string>();
-                m.x = o["x"].as<int>();
-                m.y = o["y"].as<int>();
-                m.width = o["width"].as<int>();
-                m.height = o["height"].as<int>();
-                m.scale = o["scale"].as<float>();
-                m.focused = o["focused"].as<bool>();
-                snap.monitors.push_back(m);
-            }
-        }
+        json::Reader r(line);
+        std::vector<int> occupied;
 
-        if (node["workspaces"]) {
-            const auto& ws = node["workspaces"];
-            if (ws["active"]) {
-                int active = ws["active"].as<int>();
-                // fenriz reports 0 when no output is focused
-                snap.activeWorkspace = active > 0 ? active : -1;
-            }
-            if (ws["occupied"] && ws["occupied"].IsSequence()) {
-                for (const auto& id : ws["occupied"]) {
-                    Workspace w;
-                    w.id = id.as<int>();
-                    w.name = std::to_string(w.id);
-                    w.active = (w.id == snap.activeWorkspace);
-                    snap.workspaces.push_back(w);
+        r.beginObject();
+        std::string_view key;
+        while (r.nextKey(key)) {
+            if (key == "cursor" && r.isObject()) {
+                r.beginObject();
+                std::string_view axis;
+                while (r.nextKey(axis)) {
+                    if (axis == "x")
+                        r.readFloat(snap.cursor.x);
+                    else if (axis == "y")
+                        r.readFloat(snap.cursor.y);
+                    else
+                        r.skip();
                 }
+                snap.hasCursor = true;
+            } else if (key == "outputs" && r.isArray()) {
+                r.beginArray();
+                int id = 0;
+                while (r.nextElement()) {
+                    Monitor m{};
+                    m.id = id++; // fenriz keys outputs by name; index is a stable-enough stand-in
+                    parseOutput(r, m);
+                    snap.monitors.push_back(m);
+                }
+            } else if (key == "workspaces" && r.isObject()) {
+                r.beginObject();
+                std::string_view field;
+                while (r.nextKey(field)) {
+                    if (field == "active") {
+                        int active = 0;
+                        r.readInt(active);
+                        // fenriz reports 0 when no output is focused
+                        snap.activeWorkspace = active > 0 ? active : -1;
+                    } else if (field == "occupied" && r.isArray()) {
+                        r.beginArray();
+                        while (r.nextElement()) {
+                            int id = 0;
+                            r.readInt(id);
+                            occupied.push_back(id);
+                        }
+                    } else {
+                        r.skip();
+                    }
+                }
+            } else {
+                r.skip();
             }
         }
 
+        // "active" may come after "occupied"
+        for (int id : occupied) {
+            Workspace w;
+            w.id = id;
+            w.name = std::to_string(id);
+            w.active = (id == snap.activeWorkspace);
+            snap.workspaces.push_back(w);
+        }
         return snap;
     }
 
     Fenriz::Fenriz() : Fenriz(getSocketPath()) {}
 
     Fenriz::Fenriz(const std::string& socketPath) : socketPath(socketPath) {
-        snapshot = parseFenrizSnapshot(readSnapshotLine(socketPath));
+        fd = connectSocket(socketPath);
+        std::string line;
+        try {
+            if (!readLine(fd, lines, line)) {
+                line = lines.take(); // EOF before a newline: let the parser complain
+                close(fd);
+                fd = -1;
+            }
+            state = parseFenrizSnapshot(line);
+        } catch (...) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw;
+        }
+    }
+
+    Fenriz::~Fenriz() {
+        {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            if (fd >= 0) {
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+        if (reader.joinable()) {
+            reader.join();
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    void Fenriz::follow(std::function<void()> cb) {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        if (following) {
+            return;
+        }
+        following = true;
+        onUpdate = std::move(cb);
+        if (fd < 0) {
+            debug::log(DEBUG, "fenriz closed the connection after the first snapshot, reconnecting per popup");
+            return;
+        }
+        reader = std::thread(&Fenriz::readUpdates, this);
+    }
+
+    void Fenriz::readUpdates() {
+        debug::trace::setThreadName("fenriz-updates");
+        int localFd = fd; // only this thread closes it, under connectionMutex
+
+        // bytes the constructor read past the first snapshot
+        std::string line, latest;
+        while (lines.next(line)) {
+            latest.swap(line);
+        }
+
+        char buf[4096];
+        while (true) {
+            // a burst of pushes only needs the newest: each one is the full state
+            if (!latest.empty()) {
+                debug::trace::Span span("fenriz update");
+                try {
+                    FenrizSnapshot snap = parseFenrizSnapshot(latest);
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    state = std::move(snap);
+                } catch (const std::exception& e) {
+                    debug::log(WARN, "Ignoring a fenriz snapshot: {}", e.what());
+                }
+                latest.clear();
+                span.end();
+                if (onUpdate) {
+                    onUpdate();
+                }
+            }
+
+            ssize_t n = read(localFd, buf, sizeof(buf));
+            if (n <= 0) {
+                break; // fenriz went away, or the destructor shut the socket down
+            }
+            lines.append(buf, n);
+            while (lines.next(line)) {
+                latest.swap(line);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        debug::log(DEBUG, "fenriz update stream closed");
+        close(fd);
+        fd = -1;
+    }
+
+    bool Fenriz::sendCommand(const std::string& cmd) {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        if (fd < 0) {
+            return false;
+        }
+        // a fenriz that hangs up after the snapshot would swallow the write silently
+        pollfd pfd{fd, POLLRDHUP, 0};
+        if (!following && poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR))) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        size_t off = 0;
+        while (off < cmd.size()) {
+            ssize_t n = send(fd, cmd.data() + off, cmd.size() - off, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            off += n;
+        }
+        return true;
     }
 
     Vec2 Fenriz::cursorPos() {
-        if (!snapshot.hasCursor) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!state.hasCursor) {
             throw std::runtime_error("fenriz did not report a cursor position (compositor too old?)");
         }
-        return snapshot.cursor;
+        return state.cursor;
     }
 
     std::optional<Monitor> Fenriz::monitorAtCursor(const Vec2& cursor) {
-        for (auto& m : snapshot.monitors) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        for (auto& m : state.monitors) {
             if (cursor.x >= m.x && cursor.x < m.x + m.width && cursor.y >= m.y && cursor.y < m.y + m.height) {
                 return m;
             }
@@ -130,22 +332,64 @@ namespace compositor {
         return std::nullopt;
     }
 
-    std::vector<Workspace> Fenriz::getWorkspaces() { return snapshot.workspaces; }
+    std::vector<Workspace> Fenriz::getWorkspaces() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return state.workspaces;
+    }
 
-    int Fenriz::getActiveWorkspaceId() { return snapshot.activeWorkspace; }
+    int Fenriz::getActiveWorkspaceId() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return state.activeWorkspace;
+    }
 
     std::vector<Client> Fenriz::getClients() { return {}; }
 
     bool Fenriz::supportsOverview() const { return false; }
 
+    // everything came with the last snapshot fenriz sent
+    CompositorSnapshot Fenriz::snapshot(unsigned parts) {
+        bool stale;
+        {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            stale = following && fd < 0;
+        }
+        if (stale) {
+            FenrizSnapshot fresh = parseFenrizSnapshot(readSnapshotLine(socketPath));
+            std::lock_guard<std::mutex> lock(stateMutex);
+            state = std::move(fresh);
+        }
+
+        CompositorSnapshot snap;
+        if (parts & SNAPSHOT_CURSOR) {
+            snap.cursor = cursorPos();
+        }
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (parts & SNAPSHOT_MONITORS) {
+            snap.monitors = state.monitors;
+        }
+        if (parts & SNAPSHOT_WORKSPACES) {
+            snap.workspaces = state.workspaces;
+        }
+        if (parts & SNAPSHOT_ACTIVE_WORKSPACE) {
+            snap.activeWorkspaceId = state.activeWorkspace;
+        }
+        return snap;
+    }
+
     void Fenriz::dispatchWorkspace(int id) {
         std::string cmd = "{\"cmd\":\"workspace\",\"n\":" + std::to_string(id) + "}\n";
-        int fd = connectSocket(socketPath);
-        if (write(fd, cmd.c_str(), cmd.size()) < 0) {
+        if (sendCommand(cmd)) {
+            return;
+        }
+        int oneShot = connectSocket(socketPath);
+        if (write(oneShot, cmd.c_str(), cmd.size()) < 0) {
             debug::log(ERR, "Failed to dispatch workspace {}", id);
         }
-        close(fd);
+        close(oneShot);
     }
 
-    void Fenriz::setWallpaper(const std::string& path) { (void)path; }
+    void Fenriz::setWallpaper(const std::string& path, const std::string& monitor) {
+        (void)path;
+        (void)monitor;
+    }
 } // namespace compositor
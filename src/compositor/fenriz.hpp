@@ -1,6 +1,10 @@
 #pragma once
 
 #include "compositor.hpp"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace compositor {
 
@@ -16,10 +20,28 @@ namespace compositor {
     // Split from the socket read so it can be tested without a live compositor.
     FenrizSnapshot parseFenrizSnapshot(const std::string& line);
 
+    // Cuts a stream of reads into NDJSON lines. A line may arrive over several reads and
+    // one read may carry several lines; blank lines and a trailing \r are dropped.
+    class NdjsonLines {
+    public:
+        void append(const char* data, size_t size);
+
+        // the next complete line, false until one has arrived
+        bool next(std::string& line);
+
+        // whatever is left, for a stream that ended without a final newline
+        std::string take();
+
+    private:
+        std::string buf;
+        size_t start = 0; // buf before this has been handed out
+    };
+
     class Fenriz : public Compositor {
     public:
         explicit Fenriz();
         explicit Fenriz(const std::string& socketPath);
+        ~Fenriz();
 
         Vec2 cursorPos() override;
         std::optional<Monitor> monitorAtCursor(const Vec2& cursor) override;
@@ -27,11 +49,31 @@ namespace compositor {
         std::vector<Client> getClients() override;
         int getActiveWorkspaceId() override;
         void dispatchWorkspace(int id) override;
-        void setWallpaper(const std::string& path) override;
+        void setWallpaper(const std::string& path, const std::string& monitor) override;
         bool supportsOverview() const override;
+        CompositorSnapshot snapshot(unsigned parts) override;
+
+        // Keep the connection the first snapshot came on and apply every snapshot fenriz
+        // pushes after it, on a background thread, so a resident process stays current.
+        // onUpdate runs on that thread after each one. If fenriz hangs up instead,
+        // snapshot() reconnects for a fresh one on every call.
+        void follow(std::function<void()> onUpdate = nullptr);
 
     private:
         std::string socketPath;
-        FenrizSnapshot snapshot;
+
+        std::mutex stateMutex;
+        FenrizSnapshot state;
+
+        // the long-lived connection: snapshots come in on it and commands go out on it
+        std::mutex connectionMutex;
+        int fd = -1;
+        NdjsonLines lines;
+        std::thread reader;
+        bool following = false;
+        std::function<void()> onUpdate;
+
+        void readUpdates();
+        bool sendCommand(const std::string& cmd);
     };
 } // namespace compositor
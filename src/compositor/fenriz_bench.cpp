@@ -0,0 +1,97 @@
+// update-to-render latency over the persistent fenriz connection. a stand-in fenriz
+// pushes snapshots at a fixed rate; each update a following Fenriz applies is "rendered"
+// by taking the snapshot a popup would, and timed from the moment it was pushed.
+//
+//   fenriz_bench [--rate HZ] [--count N]
+
+#include "fenriz.hpp"
+#include "fenriz_standin.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace compositor;
+
+// the sequence number rides in the active workspace
+static std::string snapshotLine(int seq) {
+    std::string outputs;
+    for (int i = 0; i < 3; ++i) {
+        outputs += std::format(R"({}{{"name":"DP-{}","focused":{},"x":{},"y":0,"width":2560,"height":1440,)"
+                               R"("scale":1.000000}})",
+                               i ? "," : "",
+                               i + 1,
+                               i == 0 ? "true" : "false",
+                               i * 2560);
+    }
+    return std::format(R"({{"outputs":[{}],"lid":"open","cursor":{{"x":{},"y":300}},)"
+                       R"("workspaces":{{"active":{},"occupied":[1,2,3,4,5,6]}},"activeWindow":null}})",
+                       outputs,
+                       seq % 2560,
+                       seq);
+}
+
+int main(int argc, char* argv[]) {
+    int rate = 240;
+    int count = 2000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rate" && i + 1 < argc) {
+            rate = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--count" && i + 1 < argc) {
+            count = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: %s [--rate HZ] [--count N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FenrizStandIn server(snapshotLine(0));
+    Fenriz fenriz(server.path());
+
+    std::vector<Clock::time_point> pushed(count + 1);
+    std::vector<double> latencies;
+    latencies.reserve(count);
+    std::atomic<int> last{0};
+    fenriz.follow([&] {
+        CompositorSnapshot snap = fenriz.snapshot(SNAPSHOT_CURSOR | SNAPSHOT_MONITORS | SNAPSHOT_WORKSPACES |
+                                                  SNAPSHOT_ACTIVE_WORKSPACE);
+        int seq = snap.activeWorkspaceId;
+        if (seq > 0 && seq <= count) {
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - pushed[seq]).count());
+            last = seq;
+        }
+    });
+
+    auto interval = std::chrono::nanoseconds(1'000'000'000 / rate);
+    auto next = Clock::now();
+    for (int seq = 1; seq <= count; ++seq) {
+        std::this_thread::sleep_until(next);
+        next += interval;
+        pushed[seq] = Clock::now();
+        server.push(snapshotLine(seq));
+    }
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (last < count && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (latencies.empty()) {
+        std::fprintf(stderr, "no updates arrived\n");
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) { return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))]; };
+    std::printf("%d snapshots at %d Hz, %zu rendered (%zu coalesced)\n",
+                count,
+                rate,
+                latencies.size(),
+                count - latencies.size());
+    std::printf("  update to render: p50 %.1f us, p99 %.1f us, max %.1f us\n", pct(0.5), pct(0.99), latencies.back());
+    return last == count ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// a local fenriz for fenriz_parse_test and fenriz_bench. every client gets the current
+// snapshot on accept and every push() after that; commands clients write back are
+// recorded. test-only, header-only
+
+#include "fenriz.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <format>
+#include <map>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace compositor {
+
+    class FenrizStandIn {
+    public:
+        explicit FenrizStandIn(std::string snapshot) : current(std::move(snapshot)) {
+            socketPath = std::format("/tmp/hyprwat-fenriz-{}-{}.sock", getpid(), (void*)this);
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+            unlink(socketPath.c_str());
+            if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, 8) < 0) {
+                throw std::runtime_error("fenriz stand-in: bind " + socketPath);
+            }
+            if (pipe(stopPipe) < 0) {
+                throw std::runtime_error("fenriz stand-in: pipe");
+            }
+            thread = std::thread([this] { run(); });
+        }
+
+        ~FenrizStandIn() {
+            char c = 0;
+            (void)!write(stopPipe[1], &c, 1);
+            thread.join();
+            for (auto& [fd, lines] : clients) {
+                close(fd);
+            }
+            close(listenFd);
+            close(stopPipe[0]);
+            close(stopPipe[1]);
+            unlink(socketPath.c_str());
+        }
+
+        const std::string& path() const { return socketPath; }
+
+        // a new snapshot, sent to every connected client and to later ones on accept
+        void push(const std::string& snapshot) {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = snapshot;
+            std::string line = snapshot + "\n";
+            for (auto& [fd, lines] : clients) {
+                (void)!send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+            }
+        }
+
+        // drop every connection, the way a fenriz without streaming does after the snapshot
+        void hangUp() {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& [fd, lines] : clients) {
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+
+        // the commands received so far, once there are at least n of them
+        std::vector<std::string> waitForCommands(size_t n, std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> lock(mutex);
+            received.wait_for(lock, timeout, [&] { return commands.size() >= n; });
+            return commands;
+        }
+
+        int accepted() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return acceptCount;
+        }
+
+    private:
+        std::string socketPath;
+        int listenFd = -1;
+        int stopPipe[2] = {-1, -1};
+        std::thread thread;
+
+        std::mutex mutex;
+        std::condition_variable received;
+        std::string current;
+        std::map<int, NdjsonLines> clients;
+        std::vector<std::string> commands;
+        int acceptCount = 0;
+
+        void run() {
+            while (true) {
+                std::vector<pollfd> fds = {{stopPipe[0], POLLIN, 0}, {listenFd, POLLIN, 0}};
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (auto& [fd, lines] : clients) {
+                        fds.push_back({fd, POLLIN, 0});
+                    }
+                }
+                if (poll(fds.data(), fds.size(), -1) < 0 || fds[0].revents) {
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (fds[1].revents & POLLIN) {
+                    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (fd >= 0) {
+                        std::string line = current + "\n";
+                        (void)!send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+                        clients[fd];
+                        ++acceptCount;
+                    }
+                }
+                for (size_t i = 2; i < fds.size(); ++i) {
+                    if (!fds[i].revents) {
+                        continue;
+                    }
+                    char buf[4096];
+                    ssize_t n = read(fds[i].fd, buf, sizeof(buf));
+                    if (n <= 0) {
+                        close(fds[i].fd);
+                        clients.erase(fds[i].fd);
+                        continue;
+                    }
+                    NdjsonLines& lines = clients[fds[i].fd];
+                    lines.append(buf, n);
+                    std::string cmd;
+                    while (lines.next(cmd)) {
+                        commands.push_back(cmd);
+                    }
+                    received.notify_all();
+                }
+            }
+        }
+    };
+
+} // namespace compositor
@@ -1,6 +1,9 @@
-// Checks the fenriz snapshot parser against canned IPC lines, so it can be verified
-// without a live compositor. See ../fenriz/docs/IPC.md for the format.
+// Checks the fenriz snapshot parser against canned IPC lines, and the streaming
+// connection against a local stand-in, so both can be verified without a live
+// compositor. See ../fenriz/docs/IPC.md for the format.
 #include "fenriz.hpp"
+#include "fenriz_standin.hpp"
+#include <atomic>
 #include <cassert>
 #include <cstdio>
 
@@ -48,10 +51,84 @@ static void testMissingCursor() {
     assert(!snap.hasCursor);
 }
 
+// Snapshots split across reads, several in one read, CRLF and keepalive blank lines.
+static void testStreamFraming() {
+    NdjsonLines lines;
+    std::string line;
+    std::string stream = "{\"a\":1}\n\n{\"b\":2}\r\n{\"c\":";
+    for (char c : stream) {
+        lines.append(&c, 1);
+        if (c == '\n' && line.empty()) {
+            assert(lines.next(line) && line == "{\"a\":1}");
+        }
+    }
+    assert(lines.next(line) && line == "{\"b\":2}");
+    assert(!lines.next(line));
+
+    lines.append("3}\n{\"d\":4}\n", 11);
+    assert(lines.next(line) && line == "{\"c\":3}");
+    assert(lines.next(line) && line == "{\"d\":4}");
+    assert(!lines.next(line));
+
+    lines.append("{\"e\":5}", 7);
+    assert(!lines.next(line));
+    assert(lines.take() == "{\"e\":5}");
+}
+
+static std::string snapshotLine(int active) {
+    return R"({"outputs":[{"name":"DP-1","focused":true,"x":0,"y":0,"width":1920,"height":1080,"scale":1.0}],)"
+           R"("cursor":{"x":10,"y":20},"workspaces":{"active":)" +
+           std::to_string(active) + R"(,"occupied":[1,2,3]}})";
+}
+
+// Pushed snapshots reach a following Fenriz, commands go out on the same connection,
+// and a fenriz that hangs up is reconnected to for each snapshot().
+static void testLiveStream() {
+    FenrizStandIn server(snapshotLine(1));
+    Fenriz fenriz(server.path());
+    assert(fenriz.getActiveWorkspaceId() == 1);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<int> updates{0};
+    fenriz.follow([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++updates;
+        cv.notify_all();
+    });
+
+    server.push(snapshotLine(2));
+    server.push(snapshotLine(3));
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(5), [&] { return fenriz.getActiveWorkspaceId() == 3; });
+    }
+    assert(fenriz.getActiveWorkspaceId() == 3);
+    assert(updates >= 1 && updates <= 2);
+
+    fenriz.dispatchWorkspace(2);
+    auto commands = server.waitForCommands(1, std::chrono::seconds(5));
+    assert(commands.size() == 1 && commands[0] == R"({"cmd":"workspace","n":2})");
+    assert(server.accepted() == 1);
+
+    server.push(snapshotLine(2));
+    server.hangUp();
+    // snapshot() serves memory until the reader has seen the hang up
+    for (int i = 0; i < 500 && server.accepted() == 1; ++i) {
+        fenriz.snapshot(SNAPSHOT_ACTIVE_WORKSPACE);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(server.accepted() > 1);
+    auto snap = fenriz.snapshot(SNAPSHOT_ACTIVE_WORKSPACE | SNAPSHOT_MONITORS);
+    assert(snap.activeWorkspaceId == 2 && snap.monitors.size() == 1);
+}
+
 int main() {
     testFullSnapshot();
     testNoFocusedOutput();
     testMissingCursor();
-    printf("fenriz parser tests passed\n");
+    testStreamFraming();
+    testLiveStream();
+    printf("fenriz parser and stream tests passed\n");
     return 0;
 }
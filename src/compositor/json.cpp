@@ -0,0 +1,292 @@
+#include "json.hpp"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace compositor::json {
+
+    void Reader::fail(const char* what) const {
+        throw std::runtime_error(std::string("JSON: ") + what + " at offset " + std::to_string(pos));
+    }
+
+    char Reader::peek() {
+        // control characters can only appear between tokens, so all of them count as space
+        while (pos < text.size() && (unsigned char)text[pos] <= ' ') {
+            ++pos;
+        }
+        return pos < text.size() ? text[pos] : '\0';
+    }
+
+    void Reader::expect(char c) {
+        if (peek() != c) {
+            fail("unexpected character");
+        }
+        ++pos;
+    }
+
+    bool Reader::atEnd() { return peek() == '\0'; }
+
+    bool Reader::isNull() { return peek() == 'n'; }
+    bool Reader::isObject() { return peek() == '{'; }
+    bool Reader::isArray() { return peek() == '['; }
+
+    void Reader::beginObject() {
+        expect('{');
+        first = true;
+    }
+
+    void Reader::beginArray() {
+        expect('[');
+        first = true;
+    }
+
+    bool Reader::nextKey(std::string_view& key) {
+        char c = peek();
+        if (c == '}') {
+            ++pos;
+            first = false;
+            return false;
+        }
+        if (!first) {
+            expect(',');
+        }
+        first = false;
+
+        bool escaped;
+        key = rawString(escaped);
+        expect(':');
+        return true;
+    }
+
+    bool Reader::nextElement() {
+        char c = peek();
+        if (c == ']') {
+            ++pos;
+            first = false;
+            return false;
+        }
+        if (!first) {
+            expect(',');
+        }
+        first = false;
+        return true;
+    }
+
+    // the characters of a number, validated by the caller's from_chars
+    std::string_view Reader::number() {
+        peek();
+        size_t start = pos;
+        while (pos < text.size()) {
+            char c = text[pos];
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                ++pos;
+            } else {
+                break;
+            }
+        }
+        if (pos == start) {
+            fail("expected a number");
+        }
+        return text.substr(start, pos - start);
+    }
+
+    // the closing quote of the string whose opening quote is before p, or nullptr
+    static const char* closingQuote(const char* p, const char* end) {
+        while (const char* q = (const char*)memchr(p, '"', end - p)) {
+            // escaped if preceded by an odd number of backslashes
+            const char* b = q;
+            while (b > p && b[-1] == '\\') {
+                --b;
+            }
+            if ((q - b) % 2 == 0) {
+                return q;
+            }
+            p = q + 1;
+        }
+        return nullptr;
+    }
+
+    // the characters between the quotes, escapes left as they are
+    std::string_view Reader::rawString(bool& escaped) {
+        expect('"');
+        const char* start = text.data() + pos;
+        const char* end = text.data() + text.size();
+        const char* q = closingQuote(start, end);
+        if (!q) {
+            pos = text.size();
+            fail("unterminated string");
+        }
+        escaped = memchr(start, '\\', q - start) != nullptr;
+        pos = q + 1 - text.data();
+        return {start, (size_t)(q - start)};
+    }
+
+    void Reader::readInt(int& out) {
+        if (isNull()) {
+            skip();
+            return;
+        }
+        std::string_view n = number();
+        // integers only need the integer part; hyprland prints some as 1.00
+        auto [end, ec] = std::from_chars(n.data(), n.data() + n.size(), out);
+        if (ec != std::errc()) {
+            fail("bad integer");
+        }
+    }
+
+    void Reader::readFloat(float& out) {
+        if (isNull()) {
+            skip();
+            return;
+        }
+        std::string_view n = number();
+        auto [end, ec] = std::from_chars(n.data(), n.data() + n.size(), out);
+        if (ec != std::errc()) {
+            fail("bad number");
+        }
+    }
+
+    void Reader::readBool(bool& out) {
+        char c = peek();
+        if (text.substr(pos, 4) == "true") {
+            out = true;
+            pos += 4;
+        } else if (text.substr(pos, 5) == "false") {
+            out = false;
+            pos += 5;
+        } else if (c == 'n') {
+            skip();
+        } else {
+            fail("expected a boolean");
+        }
+    }
+
+    static void appendUtf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    static bool hex4(std::string_view s, size_t at, unsigned& cp) {
+        if (at + 4 > s.size()) {
+            return false;
+        }
+        auto [end, ec] = std::from_chars(s.data() + at, s.data() + at + 4, cp, 16);
+        return ec == std::errc() && end == s.data() + at + 4;
+    }
+
+    void Reader::readString(std::string& out) {
+        if (isNull()) {
+            skip();
+            return;
+        }
+        bool escaped;
+        std::string_view raw = rawString(escaped);
+        if (!escaped) {
+            out.assign(raw);
+            return;
+        }
+
+        out.clear();
+        out.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            char c = raw[i];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            char e = raw[++i];
+            switch (e) {
+            case 'n':
+                out += '\n';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'u': {
+                unsigned cp;
+                if (!hex4(raw, i + 1, cp)) {
+                    fail("bad \\u escape");
+                }
+                i += 4;
+                // a surrogate pair spells one code point outside the BMP
+                unsigned low;
+                if (cp >= 0xD800 && cp < 0xDC00 && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u' &&
+                    hex4(raw, i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default: // " \ /
+                out += e;
+                break;
+            }
+        }
+    }
+
+    void Reader::skip() {
+        char c = peek();
+        if (c == '"') {
+            bool escaped;
+            rawString(escaped);
+        } else if (c == '{' || c == '[') {
+            // strings are the only place brackets don't count
+            const char* p = text.data() + pos;
+            const char* end = text.data() + text.size();
+            int depth = 0;
+            while (p < end) {
+                char ch = *p++;
+                if (ch == '"') {
+                    p = closingQuote(p, end);
+                    if (!p) {
+                        break;
+                    }
+                    ++p;
+                } else if (ch == '{' || ch == '[') {
+                    ++depth;
+                } else if ((ch == '}' || ch == ']') && --depth == 0) {
+                    pos = p - text.data();
+                    first = false;
+                    return;
+                }
+            }
+            pos = text.size();
+            fail("unterminated object");
+        } else if (c == 't' || c == 'f') {
+            bool b;
+            readBool(b);
+        } else if (c == 'n') {
+            if (text.substr(pos, 4) != "null") {
+                fail("unexpected literal");
+            }
+            pos += 4;
+        } else {
+            number();
+        }
+        first = false;
+    }
+
+} // namespace compositor::json
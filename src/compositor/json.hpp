@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace compositor::json {
+
+    // pull reader for the JSON compositors send. it walks the reply in place: keys come
+    // back as views into the input and values nobody asks for are skipped without
+    // allocating, so decoding a large j/clients costs one string per field we keep.
+    // malformed input throws std::runtime_error.
+    //
+    //   Reader r(text);
+    //   r.beginArray();
+    //   while (r.nextElement()) {
+    //       r.beginObject();
+    //       std::string_view key;
+    //       while (r.nextKey(key)) {
+    //           if (key == "id") r.readInt(id); else r.skip();
+    //       }
+    //   }
+    class Reader {
+    public:
+        explicit Reader(std::string_view text) : text(text) {}
+
+        // the next value is an object/array; consume its opening bracket
+        void beginObject();
+        void beginArray();
+
+        // advance to the next member of the current object and return its key, which
+        // must then be read or skipped. false (with the closing brace consumed) at the end
+        bool nextKey(std::string_view& key);
+
+        // advance to the next element of the current array, false at the end
+        bool nextElement();
+
+        // value readers; a null leaves out untouched
+        void readInt(int& out);
+        void readFloat(float& out);
+        void readBool(bool& out);
+        void readString(std::string& out);
+
+        // peek at the next value
+        bool isNull();
+        bool isObject();
+        bool isArray();
+
+        // skip the next value, however deeply nested
+        void skip();
+
+        // only whitespace left
+        bool atEnd();
+
+    private:
+        std::string_view text;
+        size_t pos = 0;
+        bool first = false; // no separator before the next member/element
+
+        char peek();
+        void expect(char c);
+        std::string_view number();
+        std::string_view rawString(bool& escaped);
+        [[noreturn]] void fail(const char* what) const;
+    };
+
+} // namespace compositor::json
@@ -0,0 +1,354 @@
+#include "state_model.hpp"
+#include "../debug/log.hpp"
+#include "../debug/trace.hpp"
+#include "../event_loop.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace compositor {
+
+    using hyprland::EventType;
+
+    static constexpr unsigned MODEL_PARTS =
+        SNAPSHOT_MONITORS | SNAPSHOT_WORKSPACES | SNAPSHOT_CLIENTS | SNAPSHOT_ACTIVE_WORKSPACE;
+
+    // socket2 prints addresses without the 0x j/clients has
+    static std::string clientAddress(std::string_view address) { return "0x" + std::string(address); }
+
+    StateModel::StateModel(Compositor& comp) : comp(comp) {}
+
+    StateModel::~StateModel() { stop(); }
+
+    bool StateModel::start(EventLoop* loop) {
+        try {
+            events = std::make_unique<hyprland::Events>();
+        } catch (const std::exception& e) {
+            debug::log(WARN, "Not following compositor events: {}", e.what());
+            return false;
+        }
+
+        using hyprland::eventMask;
+        events->subscribe(eventMask(EventType::WORKSPACE,
+                                    EventType::FOCUSED_MONITOR,
+                                    EventType::OPEN_WINDOW,
+                                    EventType::CLOSE_WINDOW,
+                                    EventType::MOVE_WINDOW,
+                                    EventType::WINDOW_TITLE,
+                                    EventType::CREATE_WORKSPACE,
+                                    EventType::DESTROY_WORKSPACE,
+                                    EventType::MOVE_WORKSPACE,
+                                    EventType::RENAME_WORKSPACE,
+                                    EventType::MONITOR_ADDED,
+                                    EventType::MONITOR_REMOVED,
+                                    EventType::CONFIG_RELOADED),
+                          [this](const hyprland::Event& ev) { apply(ev); });
+
+        // listen first so nothing that happens during the load is missed. on a loop the
+        // events queue up in the socket until the load is done
+        if (!loop) {
+            events->start();
+        } else if (!events->start(*loop)) {
+            events.reset();
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stale = MODEL_PARTS;
+            running = true;
+        }
+        refresh(MODEL_PARTS);
+        refresher = std::thread(&StateModel::run, this);
+        return true;
+    }
+
+    void StateModel::stop() {
+        if (events) {
+            events->stop();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+        if (refresher.joinable()) {
+            refresher.join();
+        }
+    }
+
+    void StateModel::apply(const hyprland::Event& ev) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++generation;
+        unsigned marked = 0; // parts this event leaves inexact
+
+        auto client = [&](std::string_view address) {
+            std::string addr = clientAddress(address);
+            return std::find_if(clients.begin(), clients.end(), [&](const Client& c) { return c.address == addr; });
+        };
+        auto workspace = [&](int id) {
+            return std::find_if(workspaces.begin(), workspaces.end(), [id](const Workspace& w) { return w.id == id; });
+        };
+
+        switch (ev.type) {
+        case EventType::WORKSPACE:
+            activeWorkspaceId = ev.workspaceId;
+            break;
+        case EventType::FOCUSED_MONITOR:
+            activeWorkspaceId = ev.workspaceId;
+            for (auto& m : monitors) {
+                m.focused = m.name == ev.monitor;
+            }
+            break;
+        case EventType::OPEN_WINDOW: {
+            Client c;
+            c.address = clientAddress(ev.address);
+            c.class_ = c.initialClass = ev.windowClass;
+            c.title = c.initialTitle = ev.title;
+            c.mapped = true;
+            auto w = std::find_if(
+                workspaces.begin(), workspaces.end(), [&](const Workspace& w) { return w.name == ev.workspace; });
+            if (w != workspaces.end()) {
+                c.workspaceId = w->id;
+            } else {
+                std::from_chars(ev.workspace.data(), ev.workspace.data() + ev.workspace.size(), c.workspaceId);
+            }
+            clients.push_back(std::move(c));
+            marked |= SNAPSHOT_CLIENTS; // no geometry yet, and its neighbours re-tiled
+            break;
+        }
+        case EventType::CLOSE_WINDOW:
+            if (auto c = client(ev.address); c != clients.end()) {
+                clients.erase(c);
+            }
+            marked |= SNAPSHOT_CLIENTS;
+            break;
+        case EventType::MOVE_WINDOW:
+            if (auto c = client(ev.address); c != clients.end()) {
+                c->workspaceId = ev.workspaceId;
+            }
+            marked |= SNAPSHOT_CLIENTS;
+            break;
+        case EventType::WINDOW_TITLE:
+            if (auto c = client(ev.address); c != clients.end()) {
+                c->title = ev.title;
+            }
+            break;
+        case EventType::CREATE_WORKSPACE:
+            // the overview leaves out the special workspace, like parseWorkspaces
+            if (ev.workspace != "special:magic" && workspace(ev.workspaceId) == workspaces.end()) {
+                Workspace w;
+                w.id = ev.workspaceId;
+                w.name = ev.workspace;
+                // new workspaces open on the focused monitor
+                for (const auto& m : monitors) {
+                    if (m.focused) {
+                        w.monitor = m.name;
+                    }
+                }
+                workspaces.push_back(std::move(w));
+            }
+            break;
+        case EventType::DESTROY_WORKSPACE:
+            if (auto w = workspace(ev.workspaceId); w != workspaces.end()) {
+                workspaces.erase(w);
+            }
+            break;
+        case EventType::MOVE_WORKSPACE:
+            if (auto w = workspace(ev.workspaceId); w != workspaces.end()) {
+                w->monitor = ev.monitor;
+            }
+            marked |= SNAPSHOT_CLIENTS; // its windows are on another monitor now
+            break;
+        case EventType::RENAME_WORKSPACE:
+            if (auto w = workspace(ev.workspaceId); w != workspaces.end()) {
+                w->name = ev.workspace;
+            }
+            break;
+        case EventType::MONITOR_ADDED:
+            marked |= SNAPSHOT_MONITORS | SNAPSHOT_CLIENTS;
+            break;
+        case EventType::MONITOR_REMOVED:
+            std::erase_if(monitors, [&](const Monitor& m) { return m.name == ev.monitor; });
+            marked |= SNAPSHOT_MONITORS | SNAPSHOT_WORKSPACES | SNAPSHOT_CLIENTS;
+            break;
+        case EventType::CONFIG_RELOADED:
+            marked |= MODEL_PARTS; // scales, gaps and rules may all have changed
+            break;
+        default:
+            break;
+        }
+
+        if (marked) {
+            stale |= marked;
+            ++staleEvents;
+            wake.notify_all();
+        }
+    }
+
+    void StateModel::store(const CompositorSnapshot& snap, unsigned parts) {
+        if (parts & SNAPSHOT_MONITORS)
+            monitors = snap.monitors;
+        if (parts & SNAPSHOT_WORKSPACES)
+            workspaces = snap.workspaces;
+        if (parts & SNAPSHOT_CLIENTS)
+            clients = snap.clients;
+        if (parts & SNAPSHOT_ACTIVE_WORKSPACE)
+            activeWorkspaceId = snap.activeWorkspaceId;
+    }
+
+    CompositorSnapshot StateModel::copy(unsigned parts) const {
+        CompositorSnapshot snap;
+        if (parts & SNAPSHOT_MONITORS)
+            snap.monitors = monitors;
+        if (parts & SNAPSHOT_WORKSPACES)
+            snap.workspaces = workspaces;
+        if (parts & SNAPSHOT_CLIENTS)
+            snap.clients = clients;
+        if (parts & SNAPSHOT_ACTIVE_WORKSPACE)
+            snap.activeWorkspaceId = activeWorkspaceId;
+        return snap;
+    }
+
+    void StateModel::refresh(unsigned parts) {
+        uint64_t before;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            before = staleEvents;
+        }
+
+        debug::trace::Span span("state model refresh");
+        CompositorSnapshot fresh;
+        try {
+            fresh = comp.snapshot(parts);
+        } catch (const std::exception& e) {
+            debug::log(ERR, "Failed to refresh compositor state: {}", e.what());
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        store(fresh, parts);
+        // an event that raced the fetch may or may not be in it, so fetch again
+        if (staleEvents == before) {
+            stale &= ~parts;
+        }
+    }
+
+    void StateModel::check() {
+        uint64_t before;
+        unsigned exact;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            before = generation;
+            exact = MODEL_PARTS & ~stale;
+        }
+        if (!exact) {
+            return;
+        }
+
+        CompositorSnapshot fresh;
+        try {
+            fresh = comp.snapshot(exact);
+        } catch (const std::exception& e) {
+            debug::log(ERR, "Failed to check compositor state: {}", e.what());
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (generation != before) {
+            return; // the difference could be the event, try next time
+        }
+
+        auto sameMonitor = [](const Monitor& a, const Monitor& b) {
+            return a.id == b.id && a.name == b.name && a.x == b.x && a.y == b.y && a.width == b.width &&
+                   a.height == b.height && a.scale == b.scale && a.focused == b.focused;
+        };
+        auto sameWorkspace = [](const Workspace& a, const Workspace& b) {
+            return a.id == b.id && a.name == b.name && a.monitor == b.monitor;
+        };
+        auto sameClient = [](const Client& a, const Client& b) {
+            return a.address == b.address && a.title == b.title && a.class_ == b.class_ &&
+                   a.workspaceId == b.workspaceId && a.x == b.x && a.y == b.y && a.width == b.width &&
+                   a.height == b.height && a.mapped == b.mapped && a.hidden == b.hidden;
+        };
+        // entries missing on one side or different on both, order aside
+        auto drift = [](const auto& model, const auto& real, auto same) {
+            size_t n = 0;
+            for (const auto& r : real) {
+                n += std::none_of(model.begin(), model.end(), [&](const auto& m) { return same(m, r); });
+            }
+            for (const auto& m : model) {
+                n += std::none_of(real.begin(), real.end(), [&](const auto& r) { return same(m, r); });
+            }
+            return n;
+        };
+
+        size_t monitorDrift = exact & SNAPSHOT_MONITORS ? drift(monitors, fresh.monitors, sameMonitor) : 0;
+        size_t workspaceDrift = exact & SNAPSHOT_WORKSPACES ? drift(workspaces, fresh.workspaces, sameWorkspace) : 0;
+        size_t clientDrift = exact & SNAPSHOT_CLIENTS ? drift(clients, fresh.clients, sameClient) : 0;
+        bool activeDrift = exact & SNAPSHOT_ACTIVE_WORKSPACE && activeWorkspaceId != fresh.activeWorkspaceId;
+
+        if (monitorDrift || workspaceDrift || clientDrift || activeDrift) {
+            debug::log(WARN,
+                       "Compositor state model drifted ({} monitors, {} workspaces, {} clients, active workspace {}), "
+                       "reloaded",
+                       monitorDrift,
+                       workspaceDrift,
+                       clientDrift,
+                       activeDrift ? "differs" : "ok");
+            debug::trace::instant("state model drift");
+        } else {
+            debug::log(DEBUG, "Compositor state model matches the compositor");
+        }
+        store(fresh, exact);
+    }
+
+    void StateModel::run() {
+        debug::trace::setThreadName("state-model");
+        auto nextCheck = std::chrono::steady_clock::now() + CHECK_INTERVAL;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            if (stale) {
+                // let a burst of events (a workspace of windows closing) settle first
+                if (wake.wait_for(lock, REFRESH_DELAY, [this] { return !running; })) {
+                    break;
+                }
+                unsigned parts = stale;
+                lock.unlock();
+                refresh(parts);
+                lock.lock();
+                continue;
+            }
+            if (wake.wait_until(lock, nextCheck, [this] { return !running || stale; })) {
+                continue;
+            }
+            lock.unlock();
+            check();
+            lock.lock();
+            nextCheck = std::chrono::steady_clock::now() + CHECK_INTERVAL;
+        }
+    }
+
+    CompositorSnapshot StateModel::snapshot(unsigned parts) {
+        unsigned pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = parts & stale;
+        }
+        // something changed moments ago and the refresh hasn't run yet
+        if (pending) {
+            refresh(pending);
+        }
+
+        CompositorSnapshot snap;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            snap = copy(parts);
+        }
+        if (parts & SNAPSHOT_CURSOR) {
+            snap.cursor = comp.cursorPos();
+        }
+        return snap;
+    }
+
+} // namespace compositor
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../hyprland/events.hpp"
+#include "compositor.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class EventLoop;
+
+namespace compositor {
+
+    // the compositor's monitors, workspaces and clients kept in memory and updated from
+    // hyprland's socket2, so the daemon opens a popup without asking for them again.
+    //
+    // events say what changed but not where windows ended up: opening, closing or moving
+    // a window re-tiles its workspace. those mark the clients stale and a background
+    // refresh fetches them again shortly after, off the popup path. every CHECK_INTERVAL
+    // the model is diffed against a fresh snapshot and any drift is logged and repaired.
+    class StateModel {
+    public:
+        static constexpr auto REFRESH_DELAY = std::chrono::milliseconds(50);
+        static constexpr auto CHECK_INTERVAL = std::chrono::seconds(60);
+
+        // comp answers the initial load, the refreshes and the cursor position
+        explicit StateModel(Compositor& comp);
+        ~StateModel();
+
+        // load the state and follow socket2, on its own thread or on loop's, which then
+        // also has to be the thread calling stop(); false when there is no event socket
+        bool start(EventLoop* loop = nullptr);
+        void stop();
+
+        // the requested SnapshotParts from memory. the cursor has no event and is still
+        // asked for, parts with a refresh pending are fetched now
+        CompositorSnapshot snapshot(unsigned parts);
+
+    private:
+        Compositor& comp;
+        std::unique_ptr<hyprland::Events> events;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<Monitor> monitors;
+        std::vector<Workspace> workspaces;
+        std::vector<Client> clients;
+        int activeWorkspaceId = -1;
+        unsigned stale = 0;       // SnapshotParts the events couldn't keep exact
+        uint64_t generation = 0;  // bumped by every applied event
+        uint64_t staleEvents = 0; // bumped by the ones that mark something stale
+        bool running = false;
+        std::thread refresher;
+
+        void apply(const hyprland::Event& ev);
+        void refresh(unsigned parts);
+        void check();
+        void run();
+
+        // the SNAPSHOT_MONITORS | WORKSPACES | CLIENTS | ACTIVE_WORKSPACE parts of parts
+        void store(const CompositorSnapshot& snap, unsigned parts);
+        CompositorSnapshot copy(unsigned parts) const;
+    };
+
+} // namespace compositor
@@ -27,6 +27,10 @@ public:
         return static_cast<float>(reader.GetReal(section, name, def));
     }
 
+    int getInt(const std::string& section, const std::string& name, int def = 0) const {
+        return static_cast<int>(reader.GetInteger(section, name, def));
+    }
+
     ImVec4 getColor(const std::string& section, const std::string& name, const std::string& def = "#000000FF") const {
         std::string val = reader.Get(section, name, def);
         return parseColor(val);
@@ -0,0 +1,221 @@
+#include "client.h"
+#include "protocol.h"
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static int write_all(int fd, const void* buf, size_t size) {
+    const char* p = buf;
+    while (size > 0) {
+        // MSG_NOSIGNAL: a daemon that went away is reported, not fatal
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void* buf, size_t size) {
+    char* p = buf;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int write_frame(int fd, char type, const void* data, uint32_t size) {
+    char header[HYPRWAT_FRAME_HEADER_SIZE];
+    header[0] = type;
+    memcpy(header + 1, &size, sizeof(size));
+    if (write_all(fd, header, sizeof(header)) < 0) {
+        return -1;
+    }
+    return size > 0 ? write_all(fd, data, size) : 0;
+}
+
+// copy a payload of size bytes from the daemon to out without buffering all of it
+static int relay(int fd, uint32_t size, int out) {
+    char buf[4096];
+    while (size > 0) {
+        uint32_t chunk = size < sizeof(buf) ? size : sizeof(buf);
+        if (read_all(fd, buf, chunk) < 0) {
+            return -1;
+        }
+        if (out >= 0) {
+            const char* p = buf;
+            size_t left = chunk;
+            while (left > 0) {
+                ssize_t n = write(out, p, left);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    break; // nobody is reading our output, keep draining the socket
+                }
+                p += n;
+                left -= n;
+            }
+        }
+        size -= chunk;
+    }
+    return 0;
+}
+
+static int connect_daemon(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    hyprwat_socket_path(addr.sun_path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// options the daemon can't honour for a client: it renders with its own theme, and a
+// trace is meant to show this process starting up
+static int runs_locally(int argc, const char* const argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--config") == 0 || strcmp(argv[i], "--trace") == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int hyprwat_forward(int argc, const char* const argv[], int* status) {
+    if (runs_locally(argc, argv)) {
+        return -1;
+    }
+
+    int fd = connect_daemon();
+    if (fd < 0) {
+        return -1;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        cwd[0] = '\0';
+    }
+
+    int failed = write_frame(fd, HYPRWAT_MSG_HELLO, HYPRWAT_PROTOCOL_MAGIC, strlen(HYPRWAT_PROTOCOL_MAGIC));
+    for (int i = 1; i < argc && !failed; ++i) {
+        failed = write_frame(fd, HYPRWAT_MSG_ARG, argv[i], strlen(argv[i]));
+    }
+    if (!failed) {
+        failed = write_frame(fd, HYPRWAT_MSG_CWD, cwd, strlen(cwd));
+    }
+    if (!failed) {
+        failed = write_frame(fd, HYPRWAT_MSG_RUN, "", 0);
+    }
+    if (failed) {
+        close(fd);
+        return -1;
+    }
+
+    // relay the daemon's replies, and our stdin once it asks for it
+    int forward_stdin = 0;
+    char buf[4096];
+    for (;;) {
+        struct pollfd fds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        if (poll(fds, forward_stdin ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (forward_stdin && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            // an empty frame tells the daemon stdin is done
+            write_frame(fd, HYPRWAT_MSG_STDIN, buf, n > 0 ? (uint32_t)n : 0);
+            if (n <= 0) {
+                forward_stdin = 0;
+            }
+        }
+
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+
+        char header[HYPRWAT_FRAME_HEADER_SIZE];
+        uint32_t size;
+        if (read_all(fd, header, sizeof(header)) < 0) {
+            break;
+        }
+        memcpy(&size, header + 1, sizeof(size));
+
+        switch (header[0]) {
+        case HYPRWAT_MSG_WANT_STDIN:
+            forward_stdin = 1;
+            break;
+        case HYPRWAT_MSG_STDOUT:
+            if (relay(fd, size, STDOUT_FILENO) < 0) {
+                goto lost;
+            }
+            break;
+        case HYPRWAT_MSG_STDERR:
+            if (relay(fd, size, STDERR_FILENO) < 0) {
+                goto lost;
+            }
+            break;
+        case HYPRWAT_MSG_EXIT: {
+            int32_t code = 1;
+            if (size == sizeof(code)) {
+                if (read_all(fd, &code, sizeof(code)) < 0) {
+                    goto lost;
+                }
+            }
+            close(fd);
+            *status = code;
+            return 0;
+        }
+        case HYPRWAT_MSG_BUSY:
+            close(fd);
+            return -1;
+        default:
+            // unknown frames are skipped, newer daemons may send more
+            if (relay(fd, size, -1) < 0) {
+                goto lost;
+            }
+            break;
+        }
+    }
+
+lost:
+    // the daemon went away mid-request, the popup may already have been shown
+    close(fd);
+    static const char msg[] = "[ERR] Lost connection to the hyprwat daemon\n";
+    if (write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0) {
+        // stderr is gone too, the exit status still tells
+    }
+    *status = 1;
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// client side of the resident daemon protocol (see protocol.h). plain C, shared by
+// hyprwat and the libc-only hyprwatctl.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// hand an invocation to a running hyprwat --daemon: sends argv (without argv[0]) and
+// the working directory, streams stdin if the daemon asks for it and copies its output
+// to stdout/stderr. returns 0 with the popup's exit status in *status, or -1 if there
+// is no daemon, it is busy with another popup, or argv has --config or --trace, and the
+// caller should run it itself.
+int hyprwat_forward(int argc, const char* const argv[], int* status);
+
+#ifdef __cplusplus
+}
+#endif
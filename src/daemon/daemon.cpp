@@ -1,6 +1,13 @@
 #include "daemon.hpp"
+#include "../debug/log.hpp"
+#include "client.h"
+#include "protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <thread>
 #include <unistd.h>
 
 std::string Daemon::getSocketPath() {
@@ -15,6 +22,31 @@ std::string Daemon::getSocketPath() {
     return path;
 }
 
+std::string Daemon::getResidentSocketPath() {
+    char path[sizeof(sockaddr_un::sun_path)];
+    hyprwat_socket_path(path, sizeof(path));
+    return path;
+}
+
+// connected unix socket, or -1
+int Daemon::connectTo(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 bool Daemon::sendCommand(const std::string& command) {
     std::string sock_path = getSocketPath();
     int client_fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -37,15 +69,16 @@ bool Daemon::sendCommand(const std::string& command) {
     return false;
 }
 
-bool Daemon::startServer(std::function<void(const std::string&)> commandCallback) {
+bool Daemon::startServer(EventLoop& eventLoop, std::function<void(const std::string&)> commandCallback) {
     if (running) {
         return false;
     }
 
     std::string sock_path = getSocketPath();
     unlink(sock_path.c_str()); // remove stale socket if it exists
+    listenPath = sock_path;
 
-    serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    serverFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
     if (serverFd < 0) {
         return false;
     }
@@ -63,40 +96,117 @@ bool Daemon::startServer(std::function<void(const std::string&)> commandCallback
 
     callback = commandCallback;
     running = true;
-
-    serverThread = std::thread([this]() {
-        while (running) {
-            int conn_fd = accept(serverFd, nullptr, nullptr);
-            if (conn_fd < 0) {
-                break;
-            }
-
-            char buffer[128];
-            memset(buffer, 0, sizeof(buffer));
-            ssize_t bytes = recv(conn_fd, buffer, sizeof(buffer) - 1, 0);
-            if (bytes > 0 && callback && running) {
-                callback(std::string(buffer));
-            }
-            close(conn_fd);
+    loop = &eventLoop;
+
+    // connections are read on the loop too, once their command arrives, so a client that
+    // connects and goes quiet can't stall the OSD
+    loop->add(serverFd, EPOLLIN, [this](uint32_t) {
+        int conn_fd;
+        while ((conn_fd = accept4(serverFd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+            connections.insert(conn_fd);
+            loop->add(conn_fd, EPOLLIN, [this, conn_fd](uint32_t) { readCommand(conn_fd); });
         }
     });
 
     return true;
 }
 
+void Daemon::readCommand(int fd) {
+    char buffer[128];
+    ssize_t bytes = recv(fd, buffer, sizeof(buffer), 0);
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return; // nothing yet, wait for the next wakeup
+    }
+    closeConnection(fd);
+    if (bytes > 0 && callback) {
+        callback(std::string(buffer, bytes));
+    }
+}
+
+void Daemon::closeConnection(int fd) {
+    loop->remove(fd);
+    connections.erase(fd);
+    close(fd);
+}
+
 void Daemon::stopServer() {
     running = false;
+    while (!connections.empty()) {
+        closeConnection(*connections.begin());
+    }
     if (serverFd >= 0) {
-        // shutdown first to wake up blocking accept()
-        shutdown(serverFd, SHUT_RDWR);
+        if (loop) {
+            loop->remove(serverFd);
+        }
         close(serverFd);
         serverFd = -1;
     }
-    if (serverThread.joinable()) {
-        serverThread.join();
+    loop = nullptr;
+    // only remove the socket if it is ours, it may belong to another instance
+    if (!listenPath.empty()) {
+        unlink(listenPath.c_str());
+        listenPath.clear();
     }
-    std::string sock_path = getSocketPath();
-    unlink(sock_path.c_str());
+}
+
+bool Daemon::startResident(EventLoop& eventLoop, std::function<void(std::shared_ptr<Session>)> onRequest) {
+    if (running) {
+        return false;
+    }
+
+    std::string sock_path = getResidentSocketPath();
+    int existing = connectTo(sock_path);
+    if (existing >= 0) {
+        close(existing);
+        debug::log(ERR, "A hyprwat daemon is already listening on {}", sock_path);
+        return false;
+    }
+    unlink(sock_path.c_str()); // nobody answered, so it's stale
+
+    serverFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (serverFd < 0) {
+        return false;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (bind(serverFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(serverFd, 16) != 0) {
+        debug::log(ERR, "Failed to listen on {}: {}", sock_path, strerror(errno));
+        close(serverFd);
+        serverFd = -1;
+        return false;
+    }
+
+    listenPath = sock_path;
+    running = true;
+    loop = &eventLoop;
+
+    loop->add(serverFd, EPOLLIN, [this, onRequest](uint32_t) {
+        int conn_fd;
+        while ((conn_fd = accept4(serverFd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+            // read the request off the loop so a slow client can't stall the popup
+            std::thread([conn_fd, onRequest]() {
+                auto session = std::make_shared<Session>(conn_fd);
+                if (session->readRequest()) {
+                    onRequest(session);
+                }
+            }).detach();
+        }
+    });
+
+    debug::log(INFO, "hyprwat daemon listening on {}", sock_path);
+    return true;
+}
+
+std::optional<int> Daemon::forward(int argc, const char* argv[]) {
+    int status;
+    if (hyprwat_forward(argc, argv, &status) != 0) {
+        return std::nullopt;
+    }
+    return status;
 }
 
 Daemon::~Daemon() { stopServer(); }
@@ -1,7 +1,11 @@
 #pragma once
 
-#include <atomic>
+#include "../event_loop.hpp"
+#include "session.hpp"
 #include <functional>
+#include <memory>
+#include <optional>
+#include <set>
 #include <string>
 #include <thread>
 
@@ -14,20 +18,39 @@ public:
     // Returns true if successfully connected and command sent (meaning another instance is running).
     static bool sendCommand(const std::string& command);
 
-    // Starts the socket server listener in a background thread.
-    // Commands received will trigger the provided callback.
-    bool startServer(std::function<void(const std::string&)> commandCallback);
+    // Starts the socket server listener on loop.
+    // Commands received will trigger the provided callback, on the loop's thread.
+    bool startServer(EventLoop& loop, std::function<void(const std::string&)> commandCallback);
 
     // Stops the server listener and cleans up socket files.
     void stopServer();
 
+    // Resident mode (hyprwat --daemon), see protocol.h.
+    // Listens on the resident socket, accepting on loop, and passes every complete
+    // request to onRequest, called on a per-connection thread. Fails if another daemon
+    // is already listening.
+    bool startResident(EventLoop& loop, std::function<void(std::shared_ptr<Session>)> onRequest);
+
+    // Client side: forwards this invocation to a running resident daemon, relaying
+    // stdin and its output. Returns the exit status, or nullopt if there is no daemon,
+    // it is busy with another popup, or the invocation has --config or --trace, and the
+    // caller should run the popup itself.
+    static std::optional<int> forward(int argc, const char* argv[]);
+
     // Gets the path to the Unix domain socket.
 
 private:
     int serverFd = -1;
-    std::thread serverThread;
-    std::atomic<bool> running{false};
+    EventLoop* loop = nullptr;
+    bool running = false;
     std::function<void(const std::string&)> callback;
+    std::string listenPath;
+    std::set<int> connections; // accepted by startServer, waiting for their command
+
+    void readCommand(int fd);
+    void closeConnection(int fd);
 
     static std::string getSocketPath();
+    static std::string getResidentSocketPath();
+    static int connectTo(const std::string& path);
 };
@@ -0,0 +1,81 @@
+// hyprwatctl: a libc-only front end for hotkeys. it takes the same arguments as hyprwat
+// and hands them to a running instance without loading EGL, PipeWire or ImGui:
+//   1. to a resident hyprwat --daemon, which shows the popup and returns its result
+//   2. for --volume-up/--volume-down, to a volume OSD that is already on screen
+//   3. otherwise it execs the full hyprwat, which runs the popup itself
+
+#include "client.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// same socket and raw command as Daemon::sendCommand
+static int send_volume_command(const char* command) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const char* xdg = getenv("XDG_RUNTIME_DIR");
+    if (xdg && *xdg) {
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/hyprwatd.sock", xdg);
+    } else {
+        const char* user = getenv("USER");
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/hyprwatd-%s.sock", user ? user : "default");
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+             send(fd, command, strlen(command), MSG_NOSIGNAL) == (ssize_t)strlen(command);
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+static const char* volume_command(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--volume-up") == 0)
+            return "up";
+        if (strcmp(argv[i], "--volume-down") == 0)
+            return "down";
+    }
+    return NULL;
+}
+
+// prefer the hyprwat installed next to us, then whatever is on PATH
+static void exec_hyprwat(char* argv[]) {
+    char path[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n > 0) {
+        path[n] = '\0';
+        char* slash = strrchr(path, '/');
+        if (slash && (size_t)(slash - path) + sizeof("/hyprwat") <= sizeof(path)) {
+            strcpy(slash, "/hyprwat");
+            argv[0] = path;
+            execv(path, argv);
+        }
+    }
+
+    argv[0] = "hyprwat";
+    execvp("hyprwat", argv);
+    perror("hyprwatctl: failed to run hyprwat");
+}
+
+int main(int argc, char* argv[]) {
+    int status;
+    if (hyprwat_forward(argc, (const char* const*)argv, &status) == 0) {
+        return status;
+    }
+
+    const char* volume = volume_command(argc, argv);
+    if (volume && send_volume_command(volume) == 0) {
+        return 0;
+    }
+
+    exec_hyprwat(argv);
+    return 127;
+}
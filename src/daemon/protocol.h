@@ -0,0 +1,46 @@
+#pragma once
+
+// wire format between hyprwat clients and the resident daemon (hyprwat --daemon).
+// plain C so the thin client can use it without the C++ runtime.
+//
+// every message is a frame: a 1 byte type, a 4 byte payload length in host byte
+// order, then the payload. a request is HELLO, any number of ARG and one CWD, then
+// RUN. the daemon answers with WANT_STDIN if it reads stdin (menu mode), after
+// which the client streams STDIN frames and an empty STDIN frame at EOF. it ends
+// with EXIT, or with BUSY if the daemon is showing another popup, in which case
+// the client runs the popup itself.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HYPRWAT_PROTOCOL_MAGIC "hyprwat/1"
+#define HYPRWAT_FRAME_HEADER_SIZE 5
+#define HYPRWAT_MAX_FRAME (1u << 20)
+
+enum hyprwat_message {
+    // client -> daemon
+    HYPRWAT_MSG_HELLO = 'H', // payload: HYPRWAT_PROTOCOL_MAGIC
+    HYPRWAT_MSG_ARG = 'a',   // one argument, argv[0] excluded
+    HYPRWAT_MSG_CWD = 'c',   // working directory, relative paths resolve against it
+    HYPRWAT_MSG_RUN = 'r',   // end of the request
+    HYPRWAT_MSG_STDIN = 'i', // a chunk of stdin, empty at EOF
+
+    // daemon -> client
+    HYPRWAT_MSG_WANT_STDIN = 'w', // start streaming stdin
+    HYPRWAT_MSG_STDOUT = 'o',     // write payload to stdout
+    HYPRWAT_MSG_STDERR = 'e',     // write payload to stderr
+    HYPRWAT_MSG_EXIT = 'x',       // payload: int32_t exit status, last frame
+    HYPRWAT_MSG_BUSY = 'b',       // another popup is showing, last frame
+};
+
+// path of the resident daemon's socket, $XDG_RUNTIME_DIR/hyprwat.sock
+// or /tmp/hyprwat-$USER.sock without a runtime dir
+static inline int hyprwat_socket_path(char* buf, size_t size) {
+    const char* xdg = getenv("XDG_RUNTIME_DIR");
+    if (xdg && *xdg) {
+        return snprintf(buf, size, "%s/hyprwat.sock", xdg);
+    }
+    const char* user = getenv("USER");
+    return snprintf(buf, size, "/tmp/hyprwat-%s.sock", user ? user : "default");
+}
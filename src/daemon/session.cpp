@@ -0,0 +1,148 @@
+#include "session.hpp"
+#include "protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+Session::Session(int fd) : fd(fd) {}
+
+Session::~Session() { close(fd); }
+
+static bool readAll(int fd, void* buf, size_t size) {
+    char* p = static_cast<char*>(buf);
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void* buf, size_t size) {
+    const char* p = static_cast<const char*>(buf);
+    while (size > 0) {
+        // MSG_NOSIGNAL: a client that went away must not take the daemon down with SIGPIPE
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool Session::sendFrame(char type, const void* data, uint32_t size) {
+    char header[HYPRWAT_FRAME_HEADER_SIZE];
+    header[0] = type;
+    memcpy(header + 1, &size, sizeof(size));
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return writeAll(fd, header, sizeof(header)) && (size == 0 || writeAll(fd, data, size));
+}
+
+bool Session::readFrame(char& type, std::string& payload) {
+    char header[HYPRWAT_FRAME_HEADER_SIZE];
+    if (!readAll(fd, header, sizeof(header))) {
+        return false;
+    }
+    type = header[0];
+    uint32_t size;
+    memcpy(&size, header + 1, sizeof(size));
+    if (size > HYPRWAT_MAX_FRAME) {
+        return false;
+    }
+    payload.resize(size);
+    return size == 0 || readAll(fd, payload.data(), size);
+}
+
+bool Session::readRequest() {
+    char type;
+    std::string payload;
+    if (!readFrame(type, payload) || type != HYPRWAT_MSG_HELLO || payload != HYPRWAT_PROTOCOL_MAGIC) {
+        return false;
+    }
+
+    while (readFrame(type, payload)) {
+        switch (type) {
+        case HYPRWAT_MSG_ARG:
+            args.push_back(payload);
+            break;
+        case HYPRWAT_MSG_CWD:
+            cwd = payload;
+            break;
+        case HYPRWAT_MSG_RUN:
+            return true;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+void Session::readStdin(std::function<void(const std::string&)> onLine) {
+    {
+        std::lock_guard<std::mutex> lock(stdinMutex);
+        stdinCallback = std::move(onLine);
+    }
+    sendFrame(HYPRWAT_MSG_WANT_STDIN, nullptr, 0);
+
+    // the thread keeps the session alive until the client hangs up
+    std::thread([self = shared_from_this()]() {
+        char type;
+        std::string chunk;
+        std::string line;
+        while (self->readFrame(type, chunk) && type == HYPRWAT_MSG_STDIN) {
+            bool eof = chunk.empty();
+            line += chunk;
+
+            size_t start = 0;
+            size_t pos;
+            while ((pos = line.find('\n', start)) != std::string::npos || (eof && start < line.size())) {
+                if (pos == std::string::npos) {
+                    pos = line.size();
+                }
+                if (pos > start) {
+                    std::lock_guard<std::mutex> lock(self->stdinMutex);
+                    if (self->stdinCallback) {
+                        self->stdinCallback(line.substr(start, pos - start));
+                    }
+                }
+                start = pos + 1;
+            }
+            line.erase(0, std::min(start, line.size()));
+
+            if (eof) {
+                break;
+            }
+        }
+    }).detach();
+}
+
+void Session::stopStdin() {
+    std::lock_guard<std::mutex> lock(stdinMutex);
+    stdinCallback = nullptr;
+}
+
+void Session::writeStdout(std::string_view data) { sendFrame(HYPRWAT_MSG_STDOUT, data.data(), data.size()); }
+
+void Session::writeStderr(std::string_view data) { sendFrame(HYPRWAT_MSG_STDERR, data.data(), data.size()); }
+
+void Session::exit(int status) {
+    int32_t s = status;
+    sendFrame(HYPRWAT_MSG_EXIT, &s, sizeof(s));
+}
+
+void Session::busy() { sendFrame(HYPRWAT_MSG_BUSY, nullptr, 0); }
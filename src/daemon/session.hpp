@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// one client connection to the resident daemon, see protocol.h for the wire format.
+// the request is read on the connection thread, replies may be sent from any thread.
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    explicit Session(int fd);
+    ~Session();
+
+    // read HELLO, ARG, CWD up to RUN. false if the peer isn't a hyprwat client
+    bool readRequest();
+
+    std::vector<std::string> args; // argv without argv[0]
+    std::string cwd;
+
+    // ask the client for its stdin. onLine is called for every non-empty line on a
+    // background thread until EOF, the client goes away or stopStdin() is called
+    void readStdin(std::function<void(const std::string&)> onLine);
+    void stopStdin();
+
+    void writeStdout(std::string_view data);
+    void writeStderr(std::string_view data);
+    void exit(int status);
+    void busy();
+
+private:
+    int fd;
+    std::mutex writeMutex;
+    std::mutex stdinMutex;
+    std::function<void(const std::string&)> stdinCallback;
+
+    bool sendFrame(char type, const void* data, uint32_t size);
+    bool readFrame(char& type, std::string& payload);
+};
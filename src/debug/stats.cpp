@@ -0,0 +1,111 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace debug {
+    int Histogram::bucketFor(uint64_t ns) {
+        if (ns < SUB_BUCKETS) {
+            return (int)ns;
+        }
+        int exp = 63 - std::countl_zero(ns);
+        int sub = (int)((ns >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1));
+        return (exp - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    uint64_t Histogram::bucketUpperBound(int bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        int exp = bucket / SUB_BUCKETS + SUB_BITS - 1;
+        int sub = bucket % SUB_BUCKETS;
+        uint64_t width = 1ull << (exp - SUB_BITS);
+        return ((uint64_t)(SUB_BUCKETS + sub) << (exp - SUB_BITS)) + (width - 1);
+    }
+
+    void Histogram::record(uint64_t ns) {
+        buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (ns > prev && !max_.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void Histogram::reset() {
+        for (auto& b : buckets) {
+            b.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t Histogram::percentile(double p) const {
+        uint64_t total = count();
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(p * (double)(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                // never report more than what was actually observed
+                return std::min(bucketUpperBound(i), max());
+            }
+        }
+        return max();
+    }
+
+    namespace stats {
+        static std::mutex registryMutex;
+        static std::map<std::string, std::unique_ptr<Histogram>> registry;
+        static std::map<std::string, std::string> notes;
+
+        Histogram& histogram(const std::string& name) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto& slot = registry[name];
+            if (!slot) {
+                slot = std::make_unique<Histogram>();
+            }
+            return *slot;
+        }
+
+        void note(const std::string& name, const std::string& value) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            notes[name] = value;
+        }
+
+        static std::string formatDuration(uint64_t ns) {
+            if (ns < 1000000) {
+                return std::format("{:.1f}us", ns / 1e3);
+            }
+            return std::format("{:.2f}ms", ns / 1e6);
+        }
+
+        std::string report() {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            std::string out = std::format("{:<20} {:>8} {:>10} {:>10} {:>10}\n", "phase", "count", "p50", "p99", "max");
+            for (const auto& [name, hist] : registry) {
+                if (hist->count() == 0) {
+                    continue;
+                }
+                out += std::format("{:<20} {:>8} {:>10} {:>10} {:>10}\n",
+                                   name,
+                                   hist->count(),
+                                   formatDuration(hist->percentile(0.50)),
+                                   formatDuration(hist->percentile(0.99)),
+                                   formatDuration(hist->max()));
+            }
+            for (const auto& [name, value] : notes) {
+                out += std::format("{:<20} {}\n", name, value);
+            }
+            return out;
+        }
+    } // namespace stats
+} // namespace debug
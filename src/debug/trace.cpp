@@ -0,0 +1,124 @@
+#include "trace.hpp"
+#include "log.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace debug::trace {
+    struct Event {
+        std::string name;
+        char phase; // X complete, i instant, M thread name metadata
+        int tid;
+        int64_t ts;  // microseconds since start()
+        int64_t dur; // microseconds, X only
+    };
+
+    static std::mutex eventsMutex;
+    static std::vector<Event> events;
+    static std::string outputPath;
+    static std::chrono::steady_clock::time_point origin;
+
+    static int currentTid() {
+        thread_local int tid = (int)syscall(SYS_gettid);
+        return tid;
+    }
+
+    static int64_t sinceOrigin(std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(t - origin).count();
+    }
+
+    static void push(Event&& ev) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.push_back(std::move(ev));
+    }
+
+    static std::string escape(const std::string& s) {
+        std::string out;
+        out.reserve(s.size());
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if ((unsigned char)c < 0x20) {
+                out += ' ';
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    void start(const std::string& path) {
+        if (enabled) {
+            return;
+        }
+        outputPath = path;
+        origin = std::chrono::steady_clock::now();
+        events.reserve(256);
+        enabled = true;
+        setThreadName("main");
+        std::atexit(write);
+    }
+
+    void write() {
+        if (!enabled) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        std::ofstream out(outputPath, std::ios::trunc);
+        if (!out) {
+            debug::log(ERR, "Failed to write trace to {}", outputPath);
+            return;
+        }
+
+        int pid = getpid();
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << pid
+            << ",\"args\":{\"name\":\"hyprwat\"}}";
+        for (const auto& ev : events) {
+            out << ",\n";
+            if (ev.phase == 'M') {
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << ev.tid
+                    << ",\"args\":{\"name\":\"" << escape(ev.name) << "\"}}";
+            } else if (ev.phase == 'i') {
+                out << "{\"name\":\"" << escape(ev.name) << "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":" << pid
+                    << ",\"tid\":" << ev.tid << ",\"ts\":" << ev.ts << "}";
+            } else {
+                out << "{\"name\":\"" << escape(ev.name) << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << ev.tid
+                    << ",\"ts\":" << ev.ts << ",\"dur\":" << ev.dur << "}";
+            }
+        }
+        out << "\n]}\n";
+        debug::log(INFO, "Wrote {} trace events to {}", events.size(), outputPath);
+    }
+
+    void setThreadName(const std::string& name) {
+        // cheap to call from callbacks that run repeatedly on the same thread
+        thread_local std::string current;
+        if (!enabled || current == name) {
+            return;
+        }
+        current = name;
+        push({name, 'M', currentTid(), 0, 0});
+    }
+
+    void instant(const std::string& name) {
+        if (!enabled) {
+            return;
+        }
+        push({name, 'i', currentTid(), sinceOrigin(std::chrono::steady_clock::now()), 0});
+    }
+
+    void Span::end() {
+        if (!name) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        push({name, 'X', currentTid(), sinceOrigin(begin), sinceOrigin(now) - sinceOrigin(begin)});
+        name = nullptr;
+    }
+} // namespace debug::trace
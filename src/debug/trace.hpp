@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// opt-in span tracing written as Chrome trace JSON, load the file in ui.perfetto.dev
+// or chrome://tracing. spans are recorded from any thread and written out at exit.
+namespace debug::trace {
+    // true once start() was called; when off a Span costs a single branch. atomic as it
+    // may be switched on after other threads have started
+    inline std::atomic<bool> enabled = false;
+
+    // begin tracing, the trace is written to path when the process exits
+    void start(const std::string& path);
+
+    // write everything recorded so far, called automatically at exit
+    void write();
+
+    // name the calling thread in the trace, e.g. "wallpaper-loader". repeated calls
+    // with the same name are ignored, so it can be called from inside callbacks
+    void setThreadName(const std::string& name);
+
+    // a zero-length marker
+    void instant(const std::string& name);
+
+    // records the lifetime of the scope as a complete ("X") event on the calling thread
+    class Span {
+    public:
+        explicit Span(const char* name) : name(enabled ? name : nullptr) {
+            if (this->name) {
+                begin = std::chrono::steady_clock::now();
+            }
+        }
+        ~Span() { end(); }
+
+        // finish the span before the end of the scope
+        void end();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* name;
+        std::chrono::steady_clock::time_point begin;
+    };
+} // namespace debug::trace
@@ -0,0 +1,138 @@
+#include "event_loop.hpp"
+#include "debug/log.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+EventLoop::EventLoop() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd < 0 || wakeFd < 0) {
+        throw std::runtime_error("Failed to create the event loop");
+    }
+    add(wakeFd, EPOLLIN, [this](uint32_t) {
+        uint64_t count;
+        while (read(wakeFd, &count, sizeof(count)) > 0) {
+        }
+        runPosted();
+    });
+}
+
+EventLoop::~EventLoop() {
+    // timers are ours to close, every other fd belongs to whoever added it
+    for (int timer : timers) {
+        close(timer);
+    }
+    close(wakeFd);
+    close(epollFd);
+}
+
+void EventLoop::add(int fd, uint32_t events, Handler handler) {
+    remove(fd);
+    uint64_t key = nextKey++;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = key;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error(std::string("epoll_ctl: ") + strerror(errno));
+    }
+    watches[key] = std::make_shared<Watch>(Watch{fd, std::move(handler)});
+    keys[fd] = key;
+}
+
+void EventLoop::remove(int fd) {
+    auto it = keys.find(fd);
+    if (it == keys.end()) {
+        return;
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    watches.erase(it->second);
+    keys.erase(it);
+}
+
+static itimerspec timerSpec(std::chrono::milliseconds delay, std::chrono::milliseconds interval) {
+    auto ts = [](std::chrono::milliseconds ms) {
+        return timespec{(time_t)(ms.count() / 1000), (long)(ms.count() % 1000) * 1000000};
+    };
+    return itimerspec{ts(interval), ts(delay)};
+}
+
+int EventLoop::addTimer(std::chrono::milliseconds delay,
+                        std::chrono::milliseconds interval,
+                        std::function<void()> cb) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create a timer");
+    }
+    add(fd, EPOLLIN, [fd, cb = std::move(cb)](uint32_t) {
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) > 0) {
+            cb();
+        }
+    });
+    timers.insert(fd);
+    rearm(fd, delay, interval);
+    return fd;
+}
+
+void EventLoop::rearm(int timer, std::chrono::milliseconds delay, std::chrono::milliseconds interval) {
+    itimerspec spec = timerSpec(delay, interval);
+    timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void EventLoop::removeTimer(int timer) {
+    if (timers.erase(timer)) {
+        remove(timer);
+        close(timer);
+    }
+}
+
+void EventLoop::post(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        posted.push_back(std::move(fn));
+    }
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {
+        // counter saturated, a wakeup is already pending
+    }
+}
+
+void EventLoop::runPosted() {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        ready.swap(posted);
+    }
+    for (auto& fn : ready) {
+        fn();
+    }
+}
+
+bool EventLoop::dispatch(int timeoutMs) {
+    epoll_event events[16];
+    int n = epoll_wait(epollFd, events, 16, timeoutMs);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        debug::log(ERR, "epoll_wait: {}", strerror(errno));
+        return false;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        // a handler earlier in this batch may have removed this one
+        auto it = watches.find(events[i].data.u64);
+        if (it == watches.end()) {
+            continue;
+        }
+        std::shared_ptr<Watch> watch = it->second; // alive even if it removes itself
+        watch->handler(events[i].events);
+    }
+    return true;
+}
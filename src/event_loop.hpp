@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+// One epoll set for everything the UI thread waits on: the Wayland display, the redraw
+// eventfd, the daemon's listening sockets, socket2, and timers. Handlers run on the
+// thread calling dispatch(), so an idle popup or daemon sleeps in a single epoll_wait
+// instead of one thread per source.
+class EventLoop {
+public:
+    using Handler = std::function<void(uint32_t events)>;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // call handler with the EPOLL* bits whenever fd is ready for events. the fd stays
+    // owned by the caller, remove() it before closing
+    void add(int fd, uint32_t events, Handler handler);
+    void remove(int fd);
+
+    // a timerfd firing after delay, then every interval unless that is zero. returns
+    // an id for rearm/removeTimer; a zero delay leaves it disarmed
+    int addTimer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, std::function<void()> cb);
+    void rearm(int timer, std::chrono::milliseconds delay, std::chrono::milliseconds interval);
+    void removeTimer(int timer);
+
+    // run fn on the loop thread during the next dispatch(). safe from any thread
+    void post(std::function<void()> fn);
+
+    // wait up to timeoutMs (-1: until something happens) and run what is ready.
+    // false if the wait failed
+    bool dispatch(int timeoutMs);
+
+private:
+    struct Watch {
+        int fd;
+        Handler handler;
+    };
+
+    int epollFd = -1;
+    int wakeFd = -1;
+    uint64_t nextKey = 1;                                // epoll data, never reused
+    std::map<uint64_t, std::shared_ptr<Watch>> watches; // by key
+    std::map<int, uint64_t> keys;                        // fd -> key
+    std::set<int> timers;                                // timerfds, ours to close
+
+    std::mutex postedMutex;
+    std::vector<std::function<void()>> posted;
+
+    void runPosted();
+};
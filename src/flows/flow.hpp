@@ -18,6 +18,9 @@ public:
     // Check if flow is complete
     virtual bool isDone() const = 0;
 
+    // settings beyond the theme, applied once before the first frame
+    virtual void applyConfig(const Config& config) {}
+
     // Get the final result of the flow
     virtual std::string getResult() const { return ""; }
 };
@@ -2,9 +2,13 @@
 #include "../frames/overview.hpp"
 #include "../wayland/display.hpp"
 
-OverviewFlow::OverviewFlow(compositor::Compositor& comp, wl::Display& wlDisplay, int logicalWidth, int logicalHeight)
+OverviewFlow::OverviewFlow(compositor::Compositor& comp,
+                           wl::Display& wlDisplay,
+                           int logicalWidth,
+                           int logicalHeight,
+                           compositor::CompositorSnapshot layout)
     : comp(comp), logicalWidth(logicalWidth), logicalHeight(logicalHeight) {
-    mainFrame = std::make_unique<OverviewFrame>(comp, wlDisplay, logicalWidth, logicalHeight);
+    mainFrame = std::make_unique<OverviewFrame>(comp, wlDisplay, logicalWidth, logicalHeight, std::move(layout));
 }
 
 OverviewFlow::~OverviewFlow() = default;
@@ -10,7 +10,12 @@ namespace wl {
 
 class OverviewFlow : public Flow {
 public:
-    OverviewFlow(compositor::Compositor& comp, wl::Display& wlDisplay, int logicalWidth, int logicalHeight);
+    // layout holds the SNAPSHOT_OVERVIEW parts, usually fetched with the cursor position
+    OverviewFlow(compositor::Compositor& comp,
+                 wl::Display& wlDisplay,
+                 int logicalWidth,
+                 int logicalHeight,
+                 compositor::CompositorSnapshot layout);
     ~OverviewFlow() override;
 
     Frame* getCurrentFrame() override;
@@ -1,6 +1,7 @@
 #include "simple_flows.hpp"
 #include "../frames/input.hpp"
 #include "../frames/selector.hpp"
+#include "../redraw.hpp"
 
 MenuFlow::MenuFlow() { selector = std::make_unique<Selector>(); }
 
@@ -13,7 +14,10 @@ MenuFlow::MenuFlow(const std::vector<Choice>& choices) {
 
 MenuFlow::~MenuFlow() = default;
 
-void MenuFlow::addChoice(const Choice& choice) { selector->add(choice); }
+void MenuFlow::addChoice(const Choice& choice) {
+    selector->add(choice);
+    redraw::request();
+}
 
 Frame* MenuFlow::getCurrentFrame() { return selector.get(); }
 
@@ -1,19 +1,16 @@
 #include "volume_flow.hpp"
 #include "../debug/log.hpp"
+#include "../debug/trace.hpp"
+#include "../redraw.hpp"
 #include <chrono>
-#include <thread>
 
 VolumeFlow::VolumeFlow(VolumeAction action) {
-    int retries = 100; // wait up to 500ms
-    debug::log(INFO, "[VolumeFlow] constructor started. Initial volume query: {}", audioManager.getVolume().volume);
-    while (audioManager.getVolume().volume < 0.0f && retries > 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-        retries--;
-    }
-    debug::log(INFO,
-               "[VolumeFlow] constructor finished. Retries left: {}, final volume query: {}",
-               retries,
-               audioManager.getVolume().volume);
+    // the OSD needs the current volume to adjust it, which arrives with the sink's first Props
+    debug::trace::Span span("wait for sink volume");
+    bool ready = audioManager.waitForVolume(std::chrono::milliseconds(500));
+    span.end();
+    debug::log(
+        INFO, "[VolumeFlow] sink volume {}: {}", ready ? "ready" : "not reported", audioManager.getVolume().volume);
 
     frame = std::make_unique<VolumeFrame>(audioManager, action);
 }
@@ -41,5 +38,6 @@ void VolumeFlow::handleCommand(const std::string& cmd) {
         } else if (cmd == "mute") {
             frame->toggleMute();
         }
+        redraw::request();
     }
 }
@@ -1,42 +1,84 @@
 #include "wallpaper_flow.hpp"
+#include "../debug/trace.hpp"
+#include <algorithm>
 
 // wallpaper selection flow
 // logicalWidth and logicalHeight are the size of the display in logical pixels
 WallpaperFlow::WallpaperFlow(compositor::Compositor& comp,
                              const std::string& dir,
+                             const std::string& monitor,
                              const int logicalWidth,
                              const int logicalHeight)
-    : wallpaperManager(dir), comp(comp) {
+    : wallpaperManager(dir), comp(comp), monitor(monitor), preloader(comp) {
 
     imageList = std::make_unique<ImageList>(logicalWidth, logicalHeight);
+    imageList->setOnHighlight([this](const std::vector<Wallpaper>& wallpapers, int index) {
+        wallpaperManager.focus(index);
+
+        // the highlighted one, then outwards one step at a time on both sides
+        std::vector<std::string> paths = {wallpapers[index].path};
+        int n = wallpapers.size();
+        for (int d = 1; d <= preloader.getSettings().neighbors; ++d) {
+            if (index + d < n)
+                paths.push_back(wallpapers[index + d].path);
+            if (index - d >= 0)
+                paths.push_back(wallpapers[index - d].path);
+        }
+        preloader.highlight(std::move(paths));
+    });
+
+    // scan in background, started here rather than on the first frame so it overlaps with
+    // EGL and ImGui setup. the list shows up right after it, thumbnails as they are made.
+    // meanwhile this thread tidies the cache up after the previous runs
+    loadingThread = std::thread([this]() {
+        debug::trace::setThreadName("wallpaper-loader");
+        debug::trace::Span span("scan wallpapers");
+        wallpaperManager.scan();
+        imageList->setWallpapers(wallpaperManager.getWallpapers());
+        wallpaperManager.generateThumbnails(
+            400, 225, [this](int index, const Thumbnail& thumb) { imageList->setThumbnail(index, thumb); });
+        span.end();
+
+        debug::trace::Span compactSpan("compact thumbnails");
+        wallpaperManager.compactCache();
+    });
 }
 
-WallpaperFlow::~WallpaperFlow() = default;
-
-Frame* WallpaperFlow::getCurrentFrame() {
-    if (!loadingStarted) {
-        // generate thumbnails in background
-        loadingThread = std::thread([this]() {
-            wallpaperManager.loadWallpapers();
-            const auto& wallpapers = wallpaperManager.getWallpapers();
-            imageList->addImages(wallpapers);
-        });
-        loadingStarted = true;
+WallpaperFlow::~WallpaperFlow() {
+    // the workers hand thumbnails to imageList, which goes before wallpaperManager
+    wallpaperManager.stop();
+    if (loadingThread.joinable()) {
+        loadingThread.join();
     }
+}
+
+Frame* WallpaperFlow::getCurrentFrame() { return imageList.get(); }
+
+void WallpaperFlow::applyConfig(const Config& config) {
+    WallpaperPreloader::Settings settings;
+    settings.dwell = std::chrono::milliseconds(config.getInt("wallpaper", "preload_delay", 300));
+    settings.neighbors = config.getInt("wallpaper", "preload_neighbors", 1);
+    settings.max = config.getInt("wallpaper", "preload_max", 3);
+    preloader.configure(settings);
 
-    return imageList.get();
+    int budget = config.getInt("wallpaper", "thumbnail_cache_mb", WallpaperManager::DEFAULT_CACHE_BUDGET >> 20);
+    wallpaperManager.setCacheBudget(uint64_t(std::max(budget, 0)) << 20);
 }
 
 bool WallpaperFlow::handleResult(const FrameResult& result) {
     if (result.action == FrameResult::Action::SUBMIT) {
         finalResult = result.value;
         done = true;
-        comp.setWallpaper(finalResult);
+        preloader.stop();
+        comp.setWallpaper(finalResult, monitor);
+        preloader.applied();
     } else if (result.action == FrameResult::Action::CANCEL) {
         done = true;
+        preloader.discard();
     }
 
     if (done) {
+        wallpaperManager.stop();
         if (loadingThread.joinable()) {
             loadingThread.join();
         }
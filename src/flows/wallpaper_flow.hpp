@@ -2,19 +2,22 @@
 
 #include "../compositor/compositor.hpp"
 #include "../frames/images.hpp"
+#include "../wallpaper/preloader.hpp"
 #include "flow.hpp"
-#include <atomic>
 #include <thread>
 
 class WallpaperFlow : public Flow {
 public:
+    // the wallpaper goes on monitor, or on every monitor when it is empty
     WallpaperFlow(compositor::Compositor& comp,
                   const std::string& wallpaperDir,
+                  const std::string& monitor,
                   const int logicalWidth,
                   const int logicalHeight);
     ~WallpaperFlow();
 
     Frame* getCurrentFrame() override;
+    void applyConfig(const Config& config) override;
     bool handleResult(const FrameResult& result) override;
     bool isDone() const override;
     std::string getResult() const override;
@@ -22,9 +25,10 @@ public:
 private:
     WallpaperManager wallpaperManager;
     compositor::Compositor& comp;
+    std::string monitor;
     std::unique_ptr<ImageList> imageList;
+    WallpaperPreloader preloader;
     std::string finalResult;
     std::thread loadingThread;
-    std::atomic<bool> loadingStarted{false};
     bool done = false;
 };
@@ -1,4 +1,6 @@
 #include "wifi_flow.hpp"
+#include "../debug/trace.hpp"
+#include "../redraw.hpp"
 
 // initializes frames
 WifiFlow::WifiFlow() { networkSelector = std::make_unique<Selector>(); }
@@ -12,13 +14,18 @@ WifiFlow::~WifiFlow() {
 // starts scanning for networks
 void WifiFlow::start() {
     // load known networks
+    debug::trace::Span span("listWifiNetworks");
     std::vector<WifiNetwork> knownNets = nm.listWifiNetworks();
+    span.end();
     for (const auto& net : knownNets) {
         networkDiscovered(net);
     }
     // scan for networks and add them
-    scanThread =
-        std::thread([this]() { nm.scanWifiNetworks([this](const WifiNetwork& net) { networkDiscovered(net); }, 5); });
+    scanThread = std::thread([this]() {
+        debug::trace::setThreadName("wifi-scan");
+        debug::trace::Span span("scanWifiNetworks");
+        nm.scanWifiNetworks([this](const WifiNetwork& net) { networkDiscovered(net); }, 5);
+    });
 }
 
 void WifiFlow::networkDiscovered(const WifiNetwork& network) {
@@ -34,6 +41,7 @@ void WifiFlow::networkDiscovered(const WifiNetwork& network) {
     } else {
         networkSelector->add(Choice{network.ssid, display, false, network.strength});
     }
+    redraw::request();
 }
 
 Frame* WifiFlow::getCurrentFrame() {
@@ -94,6 +102,7 @@ bool WifiFlow::handleResult(const FrameResult& result) {
                     done = true;
                     break;
                 }
+                redraw::request();
             });
 
             return true;
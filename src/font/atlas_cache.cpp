@@ -0,0 +1,216 @@
+#include "atlas_cache.hpp"
+#include "../debug/log.hpp"
+#include "../util.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace font {
+
+    // mixed into every key, so files written with another layout get other names
+    static constexpr char MAGIC[8] = {'H', 'W', 'A', 'T', 'L', 'A', 'S', '1'};
+
+    struct FileHeader {
+        char magic[8];
+        uint64_t key;
+        int32_t texWidth;
+        int32_t texHeight;
+        float fontSize;
+        float ascent;
+        float descent;
+        uint32_t glyphCount;
+        float uvWhitePixel[2];
+        float uvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1][4];
+        uint64_t pixelOffset;
+    };
+
+    struct FileGlyph {
+        uint32_t codepoint;
+        float advanceX;
+        float x0, y0, x1, y1;
+        float u0, v0, u1, v1;
+    };
+
+    AtlasCache::AtlasCache() : dir(cachePath("fonts/")) {}
+
+    AtlasCache::~AtlasCache() {
+        if (!mapped) {
+            return;
+        }
+        // the atlas would IM_FREE pixels it thinks it owns
+        char* pixels = (char*)atlas->TexPixelsRGBA32;
+        if (pixels >= (char*)mapped && pixels < (char*)mapped + mappedSize) {
+            atlas->TexPixelsRGBA32 = nullptr;
+        }
+        munmap(mapped, mappedSize);
+    }
+
+    std::string AtlasCache::filePath(ImFontAtlas* target, const std::string& path, float size, uint64_t& key) const {
+        struct stat st;
+        if (dir.empty() || stat(path.c_str(), &st) != 0) {
+            return "";
+        }
+
+        // everything that changes the baked pixels or glyph metrics. the key uses the
+        // same ranges and config AddFontFromFileTTF defaults to in UI::setupFont
+        key = FNV_OFFSET;
+        hashMix(key, path.data(), path.size());
+        hashMix(key, st.st_mtim.tv_sec);
+        hashMix(key, st.st_mtim.tv_nsec);
+        hashMix(key, st.st_size);
+        hashMix(key, size);
+        for (const ImWchar* r = target->GetGlyphRangesDefault(); *r; ++r) {
+            hashMix(key, *r);
+        }
+        hashMix(key, config.OversampleH);
+        hashMix(key, config.OversampleV);
+        hashMix(key, config.PixelSnapH);
+        hashMix(key, config.RasterizerMultiply);
+        hashMix(key, config.RasterizerDensity);
+        hashMix(key, (int)IMGUI_VERSION_NUM);
+        hashMix(key, MAGIC);
+
+        return dir + std::format("{:016x}.atlas", key);
+    }
+
+    ImFont* AtlasCache::load(ImFontAtlas* target, const std::string& path, float size) {
+        if (mapped || !target->Fonts.empty()) {
+            return nullptr;
+        }
+
+        uint64_t key;
+        std::string file = filePath(target, path, size, key);
+        if (file.empty()) {
+            return nullptr;
+        }
+
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(FileHeader)) {
+            data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+
+        const auto* header = static_cast<const FileHeader*>(data);
+        size_t pixelBytes = (size_t)header->texWidth * header->texHeight * 4;
+        size_t glyphEnd = sizeof(FileHeader) + (size_t)header->glyphCount * sizeof(FileGlyph);
+        if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->key != key || header->texWidth <= 0 ||
+            header->texHeight <= 0 || header->pixelOffset < glyphEnd || header->pixelOffset % 4 != 0 ||
+            header->pixelOffset + pixelBytes != (size_t)st.st_size) {
+            debug::log(WARN, "Ignoring stale font atlas cache {}", file);
+            munmap(data, st.st_size);
+            return nullptr;
+        }
+
+        // the same setup ImFontAtlasBuildSetupFont does, with the glyphs from the file
+        config.SizePixels = size;
+        config.FontData = nullptr;
+        config.FontDataOwnedByAtlas = false;
+        snprintf(config.Name, sizeof(config.Name), "%s", std::filesystem::path(path).filename().c_str());
+
+        ImFont* font = IM_NEW(ImFont)();
+        font->ContainerAtlas = target;
+        font->ConfigData = &config;
+        font->ConfigDataCount = 1;
+        font->FontSize = header->fontSize;
+        font->Ascent = header->ascent;
+        font->Descent = header->descent;
+
+        const auto* glyphs = reinterpret_cast<const FileGlyph*>(header + 1);
+        for (uint32_t i = 0; i < header->glyphCount; ++i) {
+            const FileGlyph& g = glyphs[i];
+            font->AddGlyph(nullptr, (ImWchar)g.codepoint, g.x0, g.y0, g.x1, g.y1, g.u0, g.v0, g.u1, g.v1, g.advanceX);
+        }
+        font->BuildLookupTable();
+        target->Fonts.push_back(font);
+
+        // GetTexDataAsRGBA32 returns these pixels untouched, so the backend uploads
+        // straight from the page cache
+        target->TexPixelsRGBA32 = (unsigned int*)((char*)data + header->pixelOffset);
+        target->TexWidth = header->texWidth;
+        target->TexHeight = header->texHeight;
+        target->TexUvScale = ImVec2(1.0f / header->texWidth, 1.0f / header->texHeight);
+        target->TexUvWhitePixel = ImVec2(header->uvWhitePixel[0], header->uvWhitePixel[1]);
+        for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; ++i) {
+            const float* l = header->uvLines[i];
+            target->TexUvLines[i] = ImVec4(l[0], l[1], l[2], l[3]);
+        }
+        target->TexReady = true;
+
+        atlas = target;
+        mapped = data;
+        mappedSize = st.st_size;
+        debug::log(DEBUG, "Loaded font atlas from cache {}", file);
+        return font;
+    }
+
+    void AtlasCache::store(ImFontAtlas* source, const ImFont* font, const std::string& path, float size) {
+        uint64_t key;
+        std::string file = filePath(source, path, size, key);
+        if (file.empty()) {
+            return;
+        }
+
+        unsigned char* pixels = nullptr;
+        int width = 0, height = 0;
+        source->GetTexDataAsRGBA32(&pixels, &width, &height);
+        if (!pixels) {
+            return;
+        }
+
+        FileHeader header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.key = key;
+        header.texWidth = width;
+        header.texHeight = height;
+        header.fontSize = font->FontSize;
+        header.ascent = font->Ascent;
+        header.descent = font->Descent;
+        header.glyphCount = font->Glyphs.Size;
+        header.uvWhitePixel[0] = source->TexUvWhitePixel.x;
+        header.uvWhitePixel[1] = source->TexUvWhitePixel.y;
+        for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; ++i) {
+            const ImVec4& l = source->TexUvLines[i];
+            header.uvLines[i][0] = l.x;
+            header.uvLines[i][1] = l.y;
+            header.uvLines[i][2] = l.z;
+            header.uvLines[i][3] = l.w;
+        }
+
+        std::vector<FileGlyph> glyphs;
+        glyphs.reserve(font->Glyphs.Size);
+        for (const ImFontGlyph& g : font->Glyphs) {
+            glyphs.push_back({g.Codepoint, g.AdvanceX, g.X0, g.Y0, g.X1, g.Y1, g.U0, g.V0, g.U1, g.V1});
+        }
+        size_t glyphEnd = sizeof(header) + glyphs.size() * sizeof(FileGlyph);
+        header.pixelOffset = (glyphEnd + 3) & ~size_t(3);
+
+        // a concurrent start never maps a half written file
+        bool written = writeFileAtomically(file, [&](std::ostream& out) {
+            static const char pad[4] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(glyphs.data()), glyphs.size() * sizeof(FileGlyph));
+            out.write(pad, header.pixelOffset - glyphEnd);
+            out.write(reinterpret_cast<const char*>(pixels), (size_t)width * height * 4);
+        });
+        if (!written) {
+            debug::log(WARN, "Failed to write font atlas cache {}", file);
+            return;
+        }
+        debug::log(DEBUG, "Stored font atlas in cache {}", file);
+    }
+
+} // namespace font
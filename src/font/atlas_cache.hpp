@@ -0,0 +1,39 @@
+#pragma once
+
+#include "imgui.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace font {
+
+    // baked ImGui font atlases kept under $XDG_CACHE_HOME/hyprwat/fonts/ so a start with
+    // an unchanged font skips rasterizing the TTF. a cache file holds the RGBA32 atlas
+    // pixels and the glyph table, keyed by font path, mtime, size, glyph ranges and the
+    // rasterizer settings. hits are mmap'd and handed to the GL backend as-is.
+    class AtlasCache {
+    public:
+        AtlasCache();
+        ~AtlasCache();
+
+        AtlasCache(const AtlasCache&) = delete;
+        AtlasCache& operator=(const AtlasCache&) = delete;
+
+        // add the cached font for path at size to an empty atlas and mark it built.
+        // returns nullptr on a miss, leaving the atlas untouched
+        ImFont* load(ImFontAtlas* atlas, const std::string& path, float size);
+
+        // persist a font that was just baked into atlas from path at size
+        void store(ImFontAtlas* atlas, const ImFont* font, const std::string& path, float size);
+
+    private:
+        std::string dir;
+        ImFontConfig config; // backs the loaded font's ConfigData, which ImGui expects to be set
+        ImFontAtlas* atlas = nullptr;
+        void* mapped = nullptr;
+        size_t mappedSize = 0;
+
+        std::string filePath(ImFontAtlas* target, const std::string& path, float size, uint64_t& key) const;
+    };
+
+} // namespace font
@@ -0,0 +1,79 @@
+// cold vs warm font setup, the part of UI::init the atlas cache changes. each round
+// makes a fresh ImGui context and does what UI::setupFont and the GL backend's first
+// upload do: a cold round bakes the TTF and stores it, a warm round maps the cache.
+// the GL upload itself takes the same pixels either way and is left out.
+//
+//   atlas_cache_bench [font.ttf] [size] [rounds]
+
+#include "atlas_cache.hpp"
+#include "font.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double setupFont(const std::string& path, float size, bool cold) {
+    auto start = Clock::now();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    {
+        font::AtlasCache cache;
+        ImFont* font = cold ? nullptr : cache.load(io.Fonts, path, size);
+        if (!font) {
+            font = io.Fonts->AddFontFromFileTTF(path.c_str(), size);
+            io.Fonts->Build();
+            if (font) {
+                cache.store(io.Fonts, font, path, size);
+            }
+        }
+        io.FontDefault = font;
+
+        unsigned char* pixels;
+        int w, h;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &w, &h);
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    ImGui::DestroyContext();
+    return ms;
+}
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : font::defaultFontPath();
+    float size = argc > 2 ? std::strtof(argv[2], nullptr) : 14.0f;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+    if (path.empty() || rounds <= 0) {
+        std::fprintf(stderr, "usage: %s [font.ttf] [size] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    // a private cache so the user's is neither used nor clobbered
+    char dir[] = "/tmp/hyprwat-atlas-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    setenv("XDG_CACHE_HOME", dir, 1);
+
+    std::vector<double> cold, warm;
+    for (int i = 0; i < rounds; ++i) {
+        std::filesystem::remove_all(std::string(dir) + "/hyprwat");
+        cold.push_back(setupFont(path, size, true));
+        warm.push_back(setupFont(path, size, false));
+    }
+    std::filesystem::remove_all(dir);
+
+    std::printf("font:  %s @ %.1fpx, %d rounds\n", path.c_str(), size, rounds);
+    std::printf("cold:  %.3f ms median, %.3f ms min\n", median(cold), *std::min_element(cold.begin(), cold.end()));
+    std::printf("warm:  %.3f ms median, %.3f ms min\n", median(warm), *std::min_element(warm.begin(), warm.end()));
+    return 0;
+}
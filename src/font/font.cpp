@@ -1,8 +1,141 @@
 #include "font.hpp"
+#include "../debug/trace.hpp"
+#include "../util.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
 #include <fontconfig/fontconfig.h>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
 namespace font {
-    std::string defaultFontPath() {
+
+    // the resolved default font is remembered in $XDG_CACHE_HOME/hyprwat/font-path:
+    //
+    //   <microseconds the fontconfig lookup took>
+    //   <font file>
+    //   <mtime ns> <fontconfig config or cache dir>
+    //   ...
+    //
+    // installing fonts runs fc-cache, adding or removing a config file touches its
+    // directory and editing one in place touches the file, so any changed mtime sends
+    // the next start back through fontconfig
+    struct Dependency {
+        int64_t mtime;
+        std::string path;
+    };
+
+    // 0 for paths that don't exist, so one appearing later also invalidates
+    static int64_t mtimeOf(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            return 0;
+        }
+        return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    static std::string readCached(const std::string& file, int64_t& lookupMicros) {
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return "";
+        }
+        // one line per config file, a distro's conf.d alone runs to a few kilobytes
+        struct stat st;
+        std::string text;
+        if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size < (1 << 20)) {
+            text.resize(st.st_size);
+        }
+        ssize_t n = text.empty() ? -1 : read(fd, text.data(), text.size());
+        close(fd);
+        if (n != (ssize_t)text.size()) {
+            return "";
+        }
+
+        std::istringstream in(text);
+        std::string path;
+        if (!(in >> lookupMicros) || !in.ignore() || !std::getline(in, path) || path.empty()) {
+            return "";
+        }
+        if (mtimeOf(path) == 0) {
+            return ""; // the font itself went away
+        }
+
+        Dependency dep;
+        while (in >> dep.mtime && in.ignore() && std::getline(in, dep.path)) {
+            if (mtimeOf(dep.path) != dep.mtime) {
+                return "";
+            }
+        }
+        return path;
+    }
+
+    static void writeCached(const std::string& file, const std::string& path, int64_t lookupMicros,
+                            const std::vector<Dependency>& deps) {
+        writeFileAtomically(file, [&](std::ostream& out) {
+            out << lookupMicros << '\n' << path << '\n';
+            for (const auto& dep : deps) {
+                out << dep.mtime << ' ' << dep.path << '\n';
+            }
+        });
+    }
+
+    // everything fontconfig loaded that decides what "sans" resolves to
+    static std::vector<Dependency> fontconfigDependencies() {
+        std::set<std::string> paths;
+
+        if (FcChar8* main = FcConfigFilename(nullptr)) {
+            paths.insert((const char*)main);
+            FcStrFree(main);
+        }
+        if (FcStrList* files = FcConfigGetConfigFiles(nullptr)) {
+            while (FcChar8* f = FcStrListNext(files)) {
+                // the file for edits, its directory for conf.d files added next to it
+                paths.insert((const char*)f);
+                paths.insert(std::filesystem::path((const char*)f).parent_path().string());
+            }
+            FcStrListDone(files);
+        }
+        if (FcStrList* dirs = FcConfigGetCacheDirs(nullptr)) {
+            while (FcChar8* d = FcStrListNext(dirs)) {
+                paths.insert((const char*)d);
+            }
+            FcStrListDone(dirs);
+        }
+
+        std::vector<Dependency> deps;
+        for (const auto& p : paths) {
+            deps.push_back({mtimeOf(p), p});
+        }
+        return deps;
+    }
+
+    static std::string lookupDefaultFontPath() {
+        std::string cache = cachePath("font-path");
+        if (!cache.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            int64_t lookupMicros = 0;
+            std::string cached = readCached(cache, lookupMicros);
+            if (!cached.empty()) {
+                if (debug::trace::enabled) {
+                    auto took = std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count();
+                    debug::trace::instant(
+                        std::format("font path cache hit, saved ~{}us", std::max<int64_t>(lookupMicros - took, 0)));
+                }
+                return cached;
+            }
+            debug::trace::instant("font path cache miss");
+        }
+
+        auto start = std::chrono::steady_clock::now();
         FcInit();
         FcPattern* pat = FcPatternCreate();
         FcPatternAddString(pat, FC_FAMILY, (const FcChar8*)"sans");
@@ -22,8 +155,28 @@ namespace font {
         }
 
         FcPatternDestroy(pat);
+        std::vector<Dependency> deps = fontconfigDependencies();
         FcFini();
 
+        if (!cache.empty() && !path.empty()) {
+            auto lookupMicros =
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+                    .count();
+            writeCached(cache, path, lookupMicros, deps);
+        }
+
         return path;
     }
+
+    std::string defaultFontPath() {
+        // startup resolves it on a worker and UI::setupFont picks it up here, waiting on
+        // the lock if the worker isn't done yet
+        static std::mutex mutex;
+        static std::optional<std::string> resolved;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!resolved) {
+            resolved = lookupDefaultFontPath();
+        }
+        return *resolved;
+    }
 } // namespace font
@@ -3,5 +3,7 @@
 #include <string>
 
 namespace font {
+    // the file fontconfig matches for "sans", looked up once per process and cached on
+    // disk between starts. safe to call from any thread
     std::string defaultFontPath();
 }
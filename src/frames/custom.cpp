@@ -285,22 +285,31 @@ FrameResult CustomFrame::executeAction(const Action& action, const std::string&
     }
 }
 
-FrameResult CustomFrame::render() {
-    // calculate desired size
+ImVec2 CustomFrame::contentSize() const {
     if (fixedWidth > 0 && fixedHeight > 0) {
-        lastSize = ImVec2(fixedWidth, fixedHeight);
-    } else {
-        ImGuiStyle& style = ImGui::GetStyle();
-        float totalHeight = style.WindowPadding.y * 2;
-        float maxWidth = fixedWidth > 0 ? fixedWidth : 400.0f;
-
-        for (const auto& widget : widgets) {
-            totalHeight += widget->getHeight() + style.ItemSpacing.y;
-        }
+        return ImVec2(fixedWidth, fixedHeight);
+    }
 
-        lastSize = ImVec2(maxWidth, totalHeight);
+    ImGuiStyle& style = ImGui::GetStyle();
+    float totalHeight = style.WindowPadding.y * 2;
+    float maxWidth = fixedWidth > 0 ? fixedWidth : 400.0f;
+
+    for (const auto& widget : widgets) {
+        totalHeight += widget->getHeight() + style.ItemSpacing.y;
     }
 
+    return ImVec2(maxWidth, totalHeight);
+}
+
+Vec2 CustomFrame::preferredSize() {
+    ImVec2 content = contentSize();
+    return Vec2{content.x, content.y};
+}
+
+FrameResult CustomFrame::render() {
+    // calculate desired size
+    lastSize = contentSize();
+
     // window to fill display
     ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
     ImGui::SetNextWindowPos(ImVec2(0, 0));
@@ -356,7 +365,7 @@ FrameResult CustomFrame::TextWidget::render(CustomFrame& frame) {
 }
 
 float CustomFrame::TextWidget::getHeight() const {
-    ImVec2 text_size = ImGui::CalcTextSize(content.c_str());
+    ImVec2 text_size = textSize(content.c_str());
     return text_size.y;
 }
 
@@ -376,7 +385,7 @@ FrameResult CustomFrame::ButtonWidget::render(CustomFrame& frame) {
 
 float CustomFrame::ButtonWidget::getHeight() const {
     ImGuiStyle& style = ImGui::GetStyle();
-    ImVec2 text_size = ImGui::CalcTextSize(label.c_str());
+    ImVec2 text_size = textSize(label.c_str());
     return text_size.y + style.FramePadding.y * 2;
 }
 
@@ -396,7 +405,7 @@ float CustomFrame::SelectableListWidget::getHeight() const {
     float height = 0;
     ImGuiStyle& style = ImGui::GetStyle();
     for (const auto& item : items) {
-        ImVec2 text_size = ImGui::CalcTextSize(item.label.c_str());
+        ImVec2 text_size = textSize(item.label.c_str());
         height += text_size.y + style.FramePadding.y * 2 + style.ItemSpacing.y;
     }
     return height;
@@ -425,7 +434,7 @@ FrameResult CustomFrame::InputWidget::render(CustomFrame& frame) {
 
 float CustomFrame::InputWidget::getHeight() const {
     ImGuiStyle& style = ImGui::GetStyle();
-    ImVec2 text_size = ImGui::CalcTextSize("Ay");
+    ImVec2 text_size = textSize("Ay");
     return text_size.y + style.FramePadding.y * 2;
 }
 
@@ -438,7 +447,7 @@ FrameResult CustomFrame::CheckboxWidget::render(CustomFrame& frame) {
 
 float CustomFrame::CheckboxWidget::getHeight() const {
     ImGuiStyle& style = ImGui::GetStyle();
-    ImVec2 text_size = ImGui::CalcTextSize(label.c_str());
+    ImVec2 text_size = textSize(label.c_str());
     return text_size.y + style.FramePadding.y * 2;
 }
 
@@ -460,7 +469,7 @@ FrameResult CustomFrame::SliderWidget::render(CustomFrame& frame) {
 
 float CustomFrame::SliderWidget::getHeight() const {
     ImGuiStyle& style = ImGui::GetStyle();
-    ImVec2 text_size = ImGui::CalcTextSize(label.c_str());
+    ImVec2 text_size = textSize(label.c_str());
     return text_size.y * 2 + style.FramePadding.y * 2 + style.ItemSpacing.y;
 }
 
@@ -488,7 +497,7 @@ FrameResult CustomFrame::ComboWidget::render(CustomFrame& frame) {
 
 float CustomFrame::ComboWidget::getHeight() const {
     ImGuiStyle& style = ImGui::GetStyle();
-    ImVec2 text_size = ImGui::CalcTextSize(label.c_str());
+    ImVec2 text_size = textSize(label.c_str());
     return text_size.y * 2 + style.FramePadding.y * 2 + style.ItemSpacing.y;
 }
 
@@ -515,6 +524,6 @@ FrameResult CustomFrame::ColorPickerWidget::render(CustomFrame& frame) {
 
 float CustomFrame::ColorPickerWidget::getHeight() const {
     ImGuiStyle& style = ImGui::GetStyle();
-    ImVec2 text_size = ImGui::CalcTextSize(label.c_str());
+    ImVec2 text_size = textSize(label.c_str());
     return text_size.y * 3 + style.FramePadding.y * 2 + style.ItemSpacing.y;
 }
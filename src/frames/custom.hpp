@@ -18,6 +18,7 @@ public:
 
     FrameResult render() override;
     Vec2 getSize() override;
+    Vec2 preferredSize() override;
     void applyTheme(const Config& config) override;
 
 private:
@@ -132,6 +133,7 @@ private:
     Action parseAction(const YAML::Node& node);
     FrameResult executeAction(const Action& action, const std::string& value = "");
     std::string replaceTokens(const std::string& str, const std::string& value);
+    ImVec2 contentSize() const;
 
     std::vector<std::unique_ptr<Widget>> widgets;
     std::string title;
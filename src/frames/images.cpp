@@ -1,20 +1,42 @@
 #include "images.hpp"
+#include "../redraw.hpp"
 #include "imgui.h"
-
-// #define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-// #define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include <stb_image_resize2.h>
-// #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
+#include <cmath>
 
 ImageList::ImageList(const int logicalWidth, const int logicalHeight)
     : Frame(), wallpapers(), logicalWidth(logicalWidth), logicalHeight(logicalHeight) {}
 
-void ImageList::addImages(const std::vector<Wallpaper>& newWallpapers) {
-    pendingWallpapers.insert(pendingWallpapers.end(), newWallpapers.begin(), newWallpapers.end());
+ImageList::~ImageList() { releaseTextures(); }
+
+void ImageList::releaseTextures() {
+    for (GLuint& texture : textures) {
+        if (texture != 0) {
+            glDeleteTextures(1, &texture);
+            texture = 0;
+        }
+    }
+}
+
+void ImageList::setWallpapers(const std::vector<Wallpaper>& newWallpapers) {
+    {
+        std::lock_guard<std::mutex> lock(wallpapersMutex);
+        pendingWallpapers = newWallpapers;
+        wallpapersChanged = true;
+    }
+    redraw::request();
+}
+
+void ImageList::setThumbnail(int index, const Thumbnail& thumb) {
+    {
+        std::lock_guard<std::mutex> lock(wallpapersMutex);
+        pendingThumbnails.emplace_back(index, thumb);
+    }
+    redraw::request();
 }
 
+// still scrolling towards the selection
+bool ImageList::isAnimating() const { return std::abs(targetScroll - scrollOffset) > 0.5f; }
+
 // https://github.com/ocornut/imgui/wiki/Image-Loading-and-Displaying-Examples#example-for-opengl-users
 FrameResult ImageList::render() {
 
@@ -67,7 +89,7 @@ FrameResult ImageList::render() {
     float totalWidthPerImage = imageWidth + spacing;
 
     // smooth scroll to selected image
-    float targetScroll = selectedIndex * totalWidthPerImage - (contentRegion.x - imageWidth) * 0.5f;
+    targetScroll = selectedIndex * totalWidthPerImage - (contentRegion.x - imageWidth) * 0.5f;
     scrollOffset += (targetScroll - scrollOffset) * 0.15f; // smooth interpolation
 
     std::lock_guard<std::mutex> lock(wallpapersMutex);
@@ -115,8 +137,19 @@ FrameResult ImageList::render() {
             // ImGui::Image((void*)(intptr_t)textures[i], ImVec2(image_width, image_height));
             ImVec2 p_min = ImGui::GetCursorScreenPos();
             ImVec2 p_max = ImVec2(p_min.x + imageWidth, p_min.y + imageHeight);
-            ImGui::GetWindowDrawList()->AddImageRounded(
-                (void*)(intptr_t)textures[i], p_min, p_max, ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, imageRounding);
+            if (textures[i] != 0) {
+                ImGui::GetWindowDrawList()->AddImageRounded((void*)(intptr_t)textures[i],
+                                                            p_min,
+                                                            p_max,
+                                                            ImVec2(0, 0),
+                                                            ImVec2(1, 1),
+                                                            IM_COL32_WHITE,
+                                                            imageRounding);
+            } else {
+                // thumbnail still on its way
+                ImGui::GetWindowDrawList()->AddRectFilled(
+                    p_min, p_max, ImGui::GetColorU32(ImGuiCol_FrameBg), imageRounding);
+            }
             ImGui::Dummy(ImVec2(imageWidth, imageHeight));
             ImGui::PopID();
 
@@ -139,29 +172,42 @@ FrameResult ImageList::render() {
 
 void ImageList::processPendingWallpapers() {
     std::lock_guard<std::mutex> lock(wallpapersMutex);
+    bool first = false;
+
+    if (wallpapersChanged) {
+        first = wallpapers.empty() && !pendingWallpapers.empty();
+        wallpapers = std::move(pendingWallpapers);
+        pendingWallpapers.clear();
+        wallpapersChanged = false;
+        releaseTextures();
+        textures.assign(wallpapers.size(), 0);
+    }
 
-    for (const auto& wallpaper : pendingWallpapers) {
-        GLuint texture = LoadTextureFromFile(wallpaper.thumbnailPath.c_str());
-        if (texture != 0) {
-            textures.push_back(texture);
-        } else {
-            debug::log(ERR, "Failed to load texture: {}", wallpaper.thumbnailPath);
-            textures.push_back(0);
+    for (const auto& [index, thumb] : pendingThumbnails) {
+        if (index >= 0 && index < (int)textures.size() && textures[index] == 0) {
+            textures[index] = uploadTexture(thumb);
         }
-        wallpapers.push_back(wallpaper);
     }
+    pendingThumbnails.clear();
 
-    pendingWallpapers.clear();
+    // the first wallpaper starts out highlighted
+    if (first && onHighlight) {
+        onHighlight(wallpapers, selectedIndex);
+    }
 }
 
 void ImageList::navigate(int direction) {
     if (textures.empty())
         return;
+    int previous = selectedIndex;
     selectedIndex += direction;
     if (selectedIndex < 0)
         selectedIndex = 0;
     if (selectedIndex >= textures.size())
         selectedIndex = textures.size() - 1;
+    if (selectedIndex != previous && onHighlight) {
+        onHighlight(wallpapers, selectedIndex);
+    }
 }
 
 Vec2 ImageList::getSize() {
@@ -173,17 +219,8 @@ Vec2 ImageList::getSize() {
     return Vec2{w + (edgePadding * 2), contentHeight + (edgePadding * 2)};
 }
 
-// load image and create an OpenGL texture
-GLuint ImageList::LoadTextureFromFile(const char* filename) {
-
-    int width, height, channels;
-    unsigned char* data = stbi_load(filename, &width, &height, &channels, 4);
-
-    if (data == nullptr) {
-        return 0;
-    }
-
-    // create OpenGL texture
+// create an OpenGL texture from the thumbnail's pixels
+GLuint ImageList::uploadTexture(const Thumbnail& thumb) {
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
@@ -194,9 +231,8 @@ GLuint ImageList::LoadTextureFromFile(const char* filename) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     // upload pixels to texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-    stbi_image_free(data);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA, thumb.width, thumb.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, thumb.data());
 
     return texture;
 }
@@ -3,21 +3,34 @@
 #include "../ui.hpp"
 #include "../wallpaper/wallpaper.hpp"
 #include <GL/gl.h>
+#include <functional>
 
 class ImageList : public Frame {
 public:
     ImageList(const int logicalWidth, const int logicalHeight);
+    ~ImageList();
     virtual FrameResult render() override;
     virtual Vec2 getSize() override;
     virtual void applyTheme(const Config& config) override;
     virtual bool shouldRepositionOnResize() const override { return false; }
     virtual bool shouldPositionAtCursor() const override { return false; }
+    virtual Vec2 preferredSize() override { return getSize(); }
+    virtual bool isAnimating() const override;
 
-    void addImages(const std::vector<Wallpaper>& wallpapers);
+    // the whole list up front, drawn as placeholders until their thumbnails arrive
+    void setWallpapers(const std::vector<Wallpaper>& wallpapers);
+
+    // the thumbnail for the wallpaper at index, from any thread
+    void setThumbnail(int index, const Thumbnail& thumb);
+
+    // called on the render thread whenever the highlighted wallpaper changes
+    using HighlightCallback = std::function<void(const std::vector<Wallpaper>& wallpapers, int index)>;
+    void setOnHighlight(HighlightCallback cb) { onHighlight = std::move(cb); }
 
 private:
     int selectedIndex = 0;
     float scrollOffset = 0.0f;
+    float targetScroll = 0.0f;
     int logicalWidth;
     int logicalHeight;
     float imageRounding = 8;
@@ -25,10 +38,14 @@ private:
     std::vector<GLuint> textures;
     std::vector<Wallpaper> wallpapers;
     std::vector<Wallpaper> pendingWallpapers;
+    bool wallpapersChanged = false;
+    std::vector<std::pair<int, Thumbnail>> pendingThumbnails;
     std::mutex wallpapersMutex;
     ImVec4 hoverColor = ImVec4(0.2f, 0.4f, 0.7f, 1.0f);
+    HighlightCallback onHighlight;
 
     void processPendingWallpapers();
-    GLuint LoadTextureFromFile(const char* filename);
+    GLuint uploadTexture(const Thumbnail& thumb);
+    void releaseTextures();
     void navigate(int direction);
 };
@@ -6,9 +6,6 @@ FrameResult TextInput::render() {
     ImVec2 framePadding = style.FramePadding;
     ImVec2 windowPadding = style.WindowPadding;
 
-    // Calculate input box size
-    float inputWidth = 300.0f; // default width for input
-
     // calculate actual size after rendering
     lastSize = ImVec2(inputWidth + windowPadding.x * 2, 50);
 
@@ -56,3 +53,10 @@ FrameResult TextInput::render() {
 }
 
 Vec2 TextInput::getSize() { return Vec2{lastSize.x, lastSize.y}; }
+
+Vec2 TextInput::preferredSize() {
+    // one line of input box, as tall as ImGui makes it
+    ImGuiStyle& style = ImGui::GetStyle();
+    float boxHeight = textSize("Ay").y + style.FramePadding.y * 2;
+    return Vec2{inputWidth + style.WindowPadding.x * 2, boxHeight + style.WindowPadding.y * 2};
+}
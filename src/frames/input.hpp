@@ -8,9 +8,11 @@ public:
     TextInput(const std::string& hint = "", bool password = false) : hint(hint), password(password) {}
     virtual FrameResult render() override;
     virtual Vec2 getSize() override;
+    virtual Vec2 preferredSize() override;
 
 private:
     static constexpr uint32_t bufSize = 128;
+    static constexpr float inputWidth = 300.0f; // default width for input
     char inputBuffer[bufSize] = {0};
     ImVec2 lastSize = ImVec2(0, 0);
     std::string hint;
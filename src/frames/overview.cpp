@@ -1,6 +1,8 @@
 #define GL_GLEXT_PROTOTYPES 1
 #include "overview.hpp"
+#include "../redraw.hpp"
 #include <algorithm>
+#include <cmath>
 #include <imgui.h>
 #include <iostream>
 #include <sstream>
@@ -24,9 +26,13 @@ const struct hyprland_toplevel_export_frame_v1_listener OverviewFrame::export_fr
     .buffer_done = OverviewFrame::handle_buffer_done,
 };
 
-OverviewFrame::OverviewFrame(compositor::Compositor& comp, wl::Display& wlDisplay, int logicalWidth, int logicalHeight)
+OverviewFrame::OverviewFrame(compositor::Compositor& comp,
+                             wl::Display& wlDisplay,
+                             int logicalWidth,
+                             int logicalHeight,
+                             compositor::CompositorSnapshot layout)
     : comp(comp), wlDisplay(wlDisplay), logicalWidth(logicalWidth), logicalHeight(logicalHeight) {
-    captureClients();
+    captureClients(std::move(layout));
 }
 
 OverviewFrame::~OverviewFrame() {
@@ -47,14 +53,14 @@ OverviewFrame::~OverviewFrame() {
     }
 }
 
-void OverviewFrame::captureClients() {
-    auto allWorkspaces = comp.getWorkspaces();
-    auto allClients = comp.getClients();
+void OverviewFrame::captureClients(compositor::CompositorSnapshot layout) {
+    auto& allWorkspaces = layout.workspaces;
+    const auto& allClients = layout.clients;
 
     // sort workspaces by id
     std::sort(allWorkspaces.begin(), allWorkspaces.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
 
-    int activeWsId = comp.getActiveWorkspaceId();
+    int activeWsId = layout.activeWorkspaceId;
 
     for (size_t i = 0; i < allWorkspaces.size(); ++i) {
         const auto& w = allWorkspaces[i];
@@ -130,11 +136,13 @@ void OverviewFrame::handle_ready(void* data,
                                  uint32_t tv_nsec) {
     auto* c = static_cast<CapturedClient*>(data);
     c->ready = true;
+    redraw::request();
 }
 
 void OverviewFrame::handle_failed(void* data, struct hyprland_toplevel_export_frame_v1* export_frame) {
     auto* c = static_cast<CapturedClient*>(data);
     c->failed = true;
+    redraw::request();
 }
 
 void OverviewFrame::handle_linux_dmabuf(void* data,
@@ -229,6 +237,13 @@ void OverviewFrame::createTexture(CapturedClient& c) {
 
         EGLImageKHR image =
             eglCreateImageKHR_ptr(display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer) nullptr, attribs);
+        if (image == EGL_NO_IMAGE_KHR) {
+            close(c.fdToClose);
+            c.fdToClose = -1;
+            c.ready = false;
+            c.failed = true;
+            return;
+        }
 
         glGenTextures(1, &c.texture);
         glBindTexture(GL_TEXTURE_2D, c.texture);
@@ -266,6 +281,12 @@ void OverviewFrame::createTexture(CapturedClient& c) {
 
         c.shmBuffer.reset();
     }
+
+    // nothing to make it from. failed, so isAnimating doesn't keep waiting on it
+    if (c.texture == 0) {
+        c.ready = false;
+        c.failed = true;
+    }
 }
 
 FrameResult OverviewFrame::render() {
@@ -329,7 +350,7 @@ FrameResult OverviewFrame::render() {
     float spacing = 20.0f;
     float totalWidthPerWs = wsWidth + spacing;
 
-    float targetScroll = selectedIndex * totalWidthPerWs - (contentRegion.x - wsWidth) * 0.5f;
+    targetScroll = selectedIndex * totalWidthPerWs - (contentRegion.x - wsWidth) * 0.5f;
     if (targetScroll < 0)
         targetScroll = 0;
     scrollOffset += (targetScroll - scrollOffset) * 0.15f;
@@ -418,6 +439,21 @@ Vec2 OverviewFrame::getSize() {
     return Vec2{w + (edgePadding * 2), wsHeight + (edgePadding * 2)};
 }
 
+// scrolling, or captured windows still waiting for their time-sliced texture upload
+bool OverviewFrame::isAnimating() const {
+    if (std::abs(targetScroll - scrollOffset) > 0.5f) {
+        return true;
+    }
+    for (const auto& w : workspaces) {
+        for (const auto& c : w.clients) {
+            if (c->ready && c->texture == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 void OverviewFrame::navigate(int direction) {
     if (workspaces.empty())
         return;
@@ -16,7 +16,11 @@
 
 class OverviewFrame : public Frame {
 public:
-    OverviewFrame(compositor::Compositor& comp, wl::Display& wlDisplay, int logicalWidth, int logicalHeight);
+    OverviewFrame(compositor::Compositor& comp,
+                  wl::Display& wlDisplay,
+                  int logicalWidth,
+                  int logicalHeight,
+                  compositor::CompositorSnapshot layout);
     ~OverviewFrame() override;
 
     FrameResult render() override;
@@ -24,6 +28,8 @@ public:
     void applyTheme(const Config& config) override;
     bool shouldRepositionOnResize() const override { return false; }
     bool shouldPositionAtCursor() const override { return false; }
+    Vec2 preferredSize() override { return getSize(); }
+    bool isAnimating() const override;
 
 private:
     struct CapturedClient {
@@ -69,8 +75,9 @@ private:
     ImVec4 hoverColor = ImVec4(0.2f, 0.4f, 0.7f, 1.0f);
     ImVec4 workspaceColor = ImVec4(0.1f, 0.1f, 0.15f, 0.8f);
     float scrollOffset = 0.0f;
+    float targetScroll = 0.0f;
 
-    void captureClients();
+    void captureClients(compositor::CompositorSnapshot layout);
     void navigate(int direction);
     void createTexture(CapturedClient& c);
     void requestCapture(std::shared_ptr<CapturedClient> c);
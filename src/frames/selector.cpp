@@ -37,6 +37,42 @@ bool Selector::RoundedSelectableFullWidth(const char* label, bool selected, floa
     return clicked;
 }
 
+ImVec2 Selector::contentSize() const {
+    if (choices.empty()) {
+        return ImVec2(200, 50); // Fallback size for loading
+    }
+
+    float maxTextWidth = 0;
+    float totalHeight = 0;
+    ImGuiStyle& style = ImGui::GetStyle();
+    ImVec2 framePadding = style.FramePadding;
+    ImVec2 windowPadding = style.WindowPadding;
+    ImVec2 itemSpacing = style.ItemSpacing;
+
+    for (const auto& choice : choices) {
+        ImVec2 textSize = Frame::textSize(choice.display.c_str());
+        maxTextWidth = std::max(maxTextWidth, textSize.x);
+        // Each item: text height + frame padding + item spacing
+        totalHeight += textSize.y + framePadding.y * 2;
+    }
+
+    // Add spacing between items (n-1 spacings for n items)
+    if (choices.size() > 1) {
+        totalHeight += itemSpacing.y * (choices.size() - 1);
+    }
+
+    // Add window padding (top and bottom) and some extra margin
+    float desiredWidth = maxTextWidth + framePadding.x * 2 + windowPadding.x * 2;
+    float desiredHeight = totalHeight + windowPadding.y * 2;
+    return ImVec2(desiredWidth, desiredHeight);
+}
+
+Vec2 Selector::preferredSize() {
+    std::lock_guard<std::mutex> lock(Input::mutex);
+    ImVec2 content = contentSize();
+    return Vec2{content.x, content.y};
+}
+
 FrameResult Selector::render() {
 
     // lock for streaming stdin
@@ -44,30 +80,7 @@ FrameResult Selector::render() {
 
     // Pre-calculate desired size based on content
     if (choices.size() > 0) {
-        float maxTextWidth = 0;
-        float totalHeight = 0;
-        ImGuiStyle& style = ImGui::GetStyle();
-        ImVec2 framePadding = style.FramePadding;
-        ImVec2 windowPadding = style.WindowPadding;
-        ImVec2 itemSpacing = style.ItemSpacing;
-
-        for (const auto& choice : choices) {
-            ImVec2 textSize = ImGui::CalcTextSize(choice.display.c_str());
-            maxTextWidth = std::max(maxTextWidth, textSize.x);
-            // Each item: text height + frame padding + item spacing
-            totalHeight += textSize.y + framePadding.y * 2;
-        }
-
-        // Add spacing between items (n-1 spacings for n items)
-        if (choices.size() > 1) {
-            totalHeight += itemSpacing.y * (choices.size() - 1);
-        }
-
-        // Add window padding (top and bottom) and some extra margin
-        float desiredWidth = maxTextWidth + framePadding.x * 2 + windowPadding.x * 2;
-        float desiredHeight = totalHeight + windowPadding.y * 2;
-
-        lastSize = ImVec2(desiredWidth, desiredHeight);
+        lastSize = contentSize();
     }
 
     // Set the window to fill the entire display
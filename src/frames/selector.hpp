@@ -37,6 +37,7 @@ public:
 
     virtual FrameResult render() override;
     virtual Vec2 getSize() override { return Vec2{lastSize.x, lastSize.y}; }
+    virtual Vec2 preferredSize() override;
     virtual void applyTheme(const Config& config) override;
 
 private:
@@ -45,4 +46,7 @@ private:
     ImVec4 activeColor = ImVec4(0.2f, 0.4f, 0.7f, 1.0f);
     ImVec4 hoverColor = ImVec4(0.2f, 0.4f, 0.7f, 0.4f);
     ImVec2 lastSize = ImVec2(0, 0);
+
+    // what the choices need, the caller holds Input::mutex
+    ImVec2 contentSize() const;
 };
@@ -26,3 +26,9 @@ FrameResult Text::render() {
 
     return FrameResult::Continue();
 }
+
+Vec2 Text::preferredSize() {
+    ImVec2 windowPadding = ImGui::GetStyle().WindowPadding;
+    ImVec2 content = textSize(text.c_str());
+    return Vec2{content.x + windowPadding.x * 2, content.y + windowPadding.y * 2};
+}
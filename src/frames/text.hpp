@@ -17,6 +17,7 @@ public:
     virtual FrameResult render() override;
 
     Vec2 getSize() override { return Vec2{lastSize.x, lastSize.y}; }
+    Vec2 preferredSize() override;
     void done() { done_ = true; }
 
 private:
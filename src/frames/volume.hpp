@@ -16,8 +16,12 @@ public:
 
     bool shouldRepositionOnResize() const override { return false; }
     bool shouldPositionAtCursor() const override { return false; }
+    Vec2 preferredSize() override { return getSize(); }
     void applyTheme(const Config& config) override;
 
+    // the OSD fades out and closes itself on a timer, so it needs frames the whole time
+    bool isAnimating() const override { return true; }
+
     void adjustVolume(float delta);
     void toggleMute();
     std::mutex frameMutex;
@@ -0,0 +1,329 @@
+#include "events.hpp"
+#include "../debug/log.hpp"
+#include "../debug/trace.hpp"
+#include "../event_loop.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace hyprland {
+
+    // socket2 lines are short; one longer than this is dropped
+    static constexpr size_t RING_SIZE = 64 * 1024;
+    static constexpr size_t RING_MASK = RING_SIZE - 1;
+    static_assert((RING_SIZE & RING_MASK) == 0, "RING_SIZE must be a power of two");
+
+    static std::string getSocketPath(const char* filename) {
+        const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+        const char* sig = std::getenv("HYPRLAND_INSTANCE_SIGNATURE");
+
+        if (!runtime || !sig) {
+            throw std::runtime_error("Not running inside Hyprland (env vars missing)");
+        }
+        return std::string(runtime) + "/hypr/" + sig + "/" + filename;
+    }
+
+    static const struct {
+        std::string_view name;
+        EventType type;
+    } EVENT_NAMES[] = {
+        {"workspacev2", EventType::WORKSPACE},
+        {"focusedmonv2", EventType::FOCUSED_MONITOR},
+        {"activewindowv2", EventType::ACTIVE_WINDOW},
+        {"openwindow", EventType::OPEN_WINDOW},
+        {"closewindow", EventType::CLOSE_WINDOW},
+        {"movewindowv2", EventType::MOVE_WINDOW},
+        {"windowtitlev2", EventType::WINDOW_TITLE},
+        {"createworkspacev2", EventType::CREATE_WORKSPACE},
+        {"destroyworkspacev2", EventType::DESTROY_WORKSPACE},
+        {"moveworkspacev2", EventType::MOVE_WORKSPACE},
+        {"renameworkspace", EventType::RENAME_WORKSPACE},
+        {"monitoraddedv2", EventType::MONITOR_ADDED},
+        {"monitorremovedv2", EventType::MONITOR_REMOVED},
+        {"configreloaded", EventType::CONFIG_RELOADED},
+    };
+
+    EventType eventType(std::string_view name) {
+        for (const auto& e : EVENT_NAMES) {
+            if (e.name == name) {
+                return e.type;
+            }
+        }
+        return EventType::OTHER;
+    }
+
+    // the first count - 1 comma separated fields, and the rest (titles may have commas)
+    static void split(std::string_view data, std::string_view* fields, size_t count) {
+        for (size_t i = 0; i + 1 < count; ++i) {
+            size_t comma = data.find(',');
+            if (comma == std::string_view::npos) {
+                fields[i] = data;
+                return;
+            }
+            fields[i] = data.substr(0, comma);
+            data.remove_prefix(comma + 1);
+        }
+        fields[count - 1] = data;
+    }
+
+    static int toInt(std::string_view s) {
+        int value = -1;
+        std::from_chars(s.data(), s.data() + s.size(), value);
+        return value;
+    }
+
+    Event parseEvent(std::string_view line) {
+        Event ev;
+        size_t sep = line.find(">>");
+        ev.name = line.substr(0, sep);
+        ev.data = sep == std::string_view::npos ? std::string_view() : line.substr(sep + 2);
+        ev.type = eventType(ev.name);
+
+        std::string_view f[4];
+        switch (ev.type) {
+        case EventType::WORKSPACE:
+        case EventType::CREATE_WORKSPACE:
+        case EventType::DESTROY_WORKSPACE:
+        case EventType::RENAME_WORKSPACE:
+            split(ev.data, f, 2);
+            ev.workspaceId = toInt(f[0]);
+            ev.workspace = f[1];
+            break;
+        case EventType::MOVE_WORKSPACE:
+            split(ev.data, f, 3);
+            ev.workspaceId = toInt(f[0]);
+            ev.workspace = f[1];
+            ev.monitor = f[2];
+            break;
+        case EventType::FOCUSED_MONITOR:
+            split(ev.data, f, 2);
+            ev.monitor = f[0];
+            ev.workspaceId = toInt(f[1]);
+            break;
+        case EventType::ACTIVE_WINDOW:
+        case EventType::CLOSE_WINDOW:
+            ev.address = ev.data;
+            break;
+        case EventType::OPEN_WINDOW:
+            split(ev.data, f, 4);
+            ev.address = f[0];
+            ev.workspace = f[1];
+            ev.windowClass = f[2];
+            ev.title = f[3];
+            break;
+        case EventType::MOVE_WINDOW:
+            split(ev.data, f, 3);
+            ev.address = f[0];
+            ev.workspaceId = toInt(f[1]);
+            ev.workspace = f[2];
+            break;
+        case EventType::WINDOW_TITLE:
+            split(ev.data, f, 2);
+            ev.address = f[0];
+            ev.title = f[1];
+            break;
+        case EventType::MONITOR_ADDED:
+        case EventType::MONITOR_REMOVED:
+            split(ev.data, f, 3);
+            ev.monitorId = toInt(f[0]);
+            ev.monitor = f[1];
+            break;
+        default:
+            break;
+        }
+        return ev;
+    }
+
+    Events::Events() : Events(getSocketPath(".socket2.sock")) {}
+
+    Events::Events(const std::string& socketPath) : socketPath(socketPath) {}
+
+    Events::~Events() { stop(); }
+
+    int Events::subscribe(EventMask mask, EventCallback cb) {
+        std::lock_guard<std::mutex> lock(subscribersMutex);
+        int id = nextId++;
+        subscribers.push_back({id, mask, std::move(cb)});
+        wanted |= mask;
+        return id;
+    }
+
+    void Events::unsubscribe(int id) {
+        std::lock_guard<std::mutex> lock(subscribersMutex);
+        std::erase_if(subscribers, [id](const Subscriber& s) { return s.id == id; });
+        EventMask mask = 0;
+        for (const auto& s : subscribers) {
+            mask |= s.mask;
+        }
+        wanted = mask;
+    }
+
+    void Events::start() {
+        if (running)
+            return;
+        running = true;
+        thread = std::thread(&Events::run, this);
+    }
+
+    bool Events::start(EventLoop& on) {
+        if (running)
+            return true;
+        int localFd = connectSocket();
+        if (localFd < 0) {
+            return false;
+        }
+        fd = localFd;
+        loop = &on;
+        running = true;
+        loop->add(fd, EPOLLIN, [this](uint32_t) {
+            if (!readSome(fd)) {
+                debug::log(WARN, "socket2 closed, no longer following compositor events");
+                stop();
+            }
+        });
+        return true;
+    }
+
+    void Events::stop() {
+        if (!running) {
+            return;
+        }
+        running = false;
+
+        if (loop) {
+            loop->remove(fd);
+            close(fd);
+            fd = -1;
+            loop = nullptr;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (fd != -1) {
+                shutdown(fd, SHUT_RD);
+            }
+        }
+
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    void Events::dispatch(std::string_view line) {
+        if (line.empty()) {
+            return;
+        }
+        // most of the stream is events nobody asked for, those stop at the name
+        EventMask bit = eventMask(eventType(line.substr(0, line.find(">>"))));
+        if (!(wanted.load(std::memory_order_relaxed) & bit)) {
+            return;
+        }
+
+        debug::trace::Span span("socket2 event");
+        Event ev = parseEvent(line);
+        std::lock_guard<std::mutex> lock(subscribersMutex);
+        for (const auto& s : subscribers) {
+            if (s.mask & bit) {
+                s.cb(ev);
+            }
+        }
+    }
+
+    int Events::connectSocket() {
+        debug::trace::Span span("socket2 connect");
+        int localFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (localFd < 0) {
+            debug::log(ERR, "Failed to create event socket");
+            return -1;
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        if (connect(localFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            debug::log(ERR, "Failed to connect to event socket: {}", std::strerror(errno));
+            close(localFd);
+            return -1;
+        }
+
+        ring = std::make_unique<char[]>(RING_SIZE);
+        head = scanned = tail = 0;
+        overlong = false;
+        return localFd;
+    }
+
+    bool Events::readSome(int from) {
+        if (tail - head == RING_SIZE) {
+            debug::log(WARN, "Dropping a socket2 event longer than {} bytes", RING_SIZE);
+            head = tail;
+            overlong = true;
+        }
+
+        size_t at = tail & RING_MASK;
+        size_t free = RING_SIZE - (tail - head);
+        size_t first = std::min(free, RING_SIZE - at);
+        iovec iov[2] = {{ring.get() + at, first}, {ring.get(), free - first}};
+        ssize_t n = readv(from, iov, free > first ? 2 : 1);
+        if (n <= 0)
+            return false; // socket closed or error
+        tail += n;
+
+        while (scanned < tail) {
+            size_t offset = scanned & RING_MASK;
+            size_t len = std::min(tail - scanned, RING_SIZE - offset);
+            const char* nl = static_cast<const char*>(memchr(ring.get() + offset, '\n', len));
+            if (!nl) {
+                scanned += len;
+                continue;
+            }
+
+            size_t end = scanned + (nl - (ring.get() + offset));
+            size_t start = head & RING_MASK;
+            size_t size = end - head;
+            if (overlong) {
+                overlong = false;
+            } else if (start + size <= RING_SIZE) {
+                dispatch({ring.get() + start, size});
+            } else {
+                wrapped.assign(ring.get() + start, RING_SIZE - start);
+                wrapped.append(ring.get(), size - (RING_SIZE - start));
+                dispatch(wrapped);
+            }
+            head = scanned = end + 1;
+        }
+        return true;
+    }
+
+    void Events::run() {
+        debug::trace::setThreadName("hyprland-events");
+        int localFd = connectSocket();
+        if (localFd < 0) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            fd = localFd;
+        }
+
+        while (running && readSome(localFd)) {
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            close(fd);
+            fd = -1;
+        }
+    }
+
+} // namespace hyprland
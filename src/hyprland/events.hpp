@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class EventLoop;
+
+namespace hyprland {
+
+    // the socket2 events hyprwat understands. where Hyprland sends a v1 and a v2 form
+    // of the same event only the v2 one, which carries ids and addresses, is decoded;
+    // the v1 duplicate comes through as OTHER
+    enum class EventType : uint8_t {
+        WORKSPACE,         // workspacev2>>ID,NAME
+        FOCUSED_MONITOR,   // focusedmonv2>>MONNAME,WORKSPACEID
+        ACTIVE_WINDOW,     // activewindowv2>>ADDRESS
+        OPEN_WINDOW,       // openwindow>>ADDRESS,WORKSPACENAME,CLASS,TITLE
+        CLOSE_WINDOW,      // closewindow>>ADDRESS
+        MOVE_WINDOW,       // movewindowv2>>ADDRESS,WORKSPACEID,WORKSPACENAME
+        WINDOW_TITLE,      // windowtitlev2>>ADDRESS,TITLE
+        CREATE_WORKSPACE,  // createworkspacev2>>ID,NAME
+        DESTROY_WORKSPACE, // destroyworkspacev2>>ID,NAME
+        MOVE_WORKSPACE,    // moveworkspacev2>>ID,NAME,MONNAME
+        RENAME_WORKSPACE,  // renameworkspace>>ID,NEWNAME
+        MONITOR_ADDED,     // monitoraddedv2>>ID,NAME,DESCRIPTION
+        MONITOR_REMOVED,   // monitorremovedv2>>ID,NAME,DESCRIPTION
+        CONFIG_RELOADED,   // configreloaded>>
+        OTHER,
+        COUNT
+    };
+
+    using EventMask = uint32_t;
+
+    constexpr EventMask eventMask(EventType type) { return EventMask(1) << (unsigned)type; }
+
+    template <typename... Types> constexpr EventMask eventMask(EventType type, Types... more) {
+        return eventMask(type) | eventMask(more...);
+    }
+
+    constexpr EventMask ALL_EVENTS = eventMask(EventType::COUNT) - 1;
+
+    // one decoded socket2 line. the views point into the reader's buffer and are only
+    // valid during the callback; fields the event doesn't carry are left empty / -1
+    struct Event {
+        EventType type = EventType::OTHER;
+        std::string_view name; // before ">>"
+        std::string_view data; // after ">>", undecoded
+        std::string_view address;
+        std::string_view workspace;
+        std::string_view monitor;
+        std::string_view windowClass;
+        std::string_view title;
+        int workspaceId = -1;
+        int monitorId = -1;
+    };
+
+    // just the type, from the event name
+    EventType eventType(std::string_view name);
+
+    // split a socket2 line into an Event
+    Event parseEvent(std::string_view line);
+
+    // listens on socket2, on a background thread or on an EventLoop. lines are cut out of
+    // a ring buffer in place and only decoded when some subscriber wants their type
+    class Events {
+    public:
+        using EventCallback = std::function<void(const Event&)>;
+
+        explicit Events();
+        explicit Events(const std::string& socketPath);
+        ~Events();
+
+        // cb runs on the listener (or loop) thread for every event whose type is in mask.
+        // returns an id for unsubscribe. neither may be called from inside a callback
+        int subscribe(EventMask mask, EventCallback cb);
+        void unsubscribe(int id);
+
+        // Start listening on a background thread
+        void start();
+
+        // connect now and read on loop's thread instead; false if socket2 is not there.
+        // stop() must then be called on that thread too
+        bool start(EventLoop& loop);
+
+        // Stop listening
+        void stop();
+
+    private:
+        struct Subscriber {
+            int id;
+            EventMask mask;
+            EventCallback cb;
+        };
+
+        void run();
+        int connectSocket();
+        bool readSome(int from); // one read, dispatching every complete line
+        void dispatch(std::string_view line);
+
+        std::string socketPath;
+        std::thread thread;
+        EventLoop* loop = nullptr;
+        std::atomic<bool> running{false};
+        std::mutex mtx;
+        int fd{-1};
+
+        // positions only ever grow, & RING_MASK turns them into offsets. [head, tail)
+        // is unconsumed, [head, scanned) is known to hold no newline
+        std::unique_ptr<char[]> ring;
+        size_t head = 0, scanned = 0, tail = 0;
+        bool overlong = false; // dropping the rest of a line that didn't fit
+        std::string wrapped;   // a line straddling the end of the ring, reused
+
+        std::mutex subscribersMutex;
+        std::vector<Subscriber> subscribers;
+        std::atomic<EventMask> wanted{0};
+        int nextId = 1;
+    };
+} // namespace hyprland
@@ -0,0 +1,190 @@
+// socket2 throughput, hyprland::Events against the read/substr/erase loop it replaced.
+// a local socket replays a recorded stream (socat -U - UNIX-CONNECT:$XDG_RUNTIME_DIR/
+// hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket2.sock > events.log) or, without one, a
+// made up burst of window and workspace churn. the subscriber only asks for workspace
+// and active window changes, like an overview keeping itself current would.
+//
+//   events_bench [events.log] [--loops N]
+
+#include "events.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+using namespace hyprland;
+
+static constexpr EventMask WANTED = eventMask(EventType::WORKSPACE, EventType::ACTIVE_WINDOW);
+
+// what a busy session sends: every action comes as its v1 and v2 event
+static std::string syntheticStream(int actions) {
+    static const char* apps[] = {"kitty", "firefox", "code", "org.gnome.Nautilus"};
+    std::string out;
+    for (int i = 0; i < actions; ++i) {
+        const char* app = apps[i % 4];
+        unsigned long addr = 0x55d1c1b0e0a0 + (i % 64) * 0x1d0;
+        int ws = i % 9 + 1;
+        switch (i % 4) {
+        case 0:
+            out += std::format("workspace>>{0}\nworkspacev2>>{0},{0}\nfocusedmon>>DP-1,{0}\nfocusedmonv2>>DP-1,{0}\n",
+                               ws);
+            break;
+        case 1:
+            out += std::format("activewindow>>{},{} - editing file {}.cpp\nactivewindowv2>>{:x}\n", app, app, i, addr);
+            break;
+        case 2:
+            out += std::format("windowtitle>>{:x}\nwindowtitlev2>>{:x},{} - tab {}\n", addr, addr, app, i);
+            break;
+        default:
+            out += std::format("openwindow>>{:x},{},{},{}\nclosewindow>>{:x}\n", addr, ws, app, app, addr);
+            break;
+        }
+    }
+    return out;
+}
+
+// serves the stream once to the next client, then hangs up
+static std::thread serveOnce(int listenFd, const std::string& stream, int loops) {
+    return std::thread([listenFd, &stream, loops] {
+        int fd = accept(listenFd, nullptr, nullptr);
+        for (int i = 0; i < loops && fd >= 0; ++i) {
+            size_t off = 0;
+            while (off < stream.size()) {
+                ssize_t n = write(fd, stream.data() + off, stream.size() - off);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                off += n;
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    });
+}
+
+// the loop before the ring buffer
+static size_t legacyListen(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+    size_t matched = 0;
+    auto cb = [&matched](const std::string& event) {
+        if (event.starts_with("workspacev2>>") || event.starts_with("activewindowv2>>")) {
+            ++matched;
+        }
+    };
+
+    char buf[1024];
+    std::string line;
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        line.append(buf, n);
+        size_t pos;
+        while ((pos = line.find('\n')) != std::string::npos) {
+            std::string event = line.substr(0, pos);
+            line.erase(0, pos + 1);
+            if (!event.empty()) {
+                cb(event);
+            }
+        }
+    }
+    close(fd);
+    return matched;
+}
+
+int main(int argc, char* argv[]) {
+    int loops = 20;
+    std::string stream;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--loops" && i + 1 < argc) {
+            loops = std::max(1, std::atoi(argv[++i]));
+            continue;
+        }
+        std::ifstream in(arg);
+        if (!in) {
+            std::fprintf(stderr, "usage: %s [events.log] [--loops N]\n", argv[0]);
+            return 1;
+        }
+        std::stringstream ss;
+        ss << in.rdbuf();
+        stream = ss.str();
+    }
+    if (stream.empty()) {
+        stream = syntheticStream(50000);
+    }
+
+    size_t lines = 0, expected = 0;
+    for (size_t start = 0, nl; (nl = stream.find('\n', start)) != std::string::npos; start = nl + 1) {
+        std::string_view line(stream.data() + start, nl - start);
+        if (!line.empty()) {
+            ++lines;
+            expected += (eventMask(parseEvent(line).type) & WANTED) != 0;
+        }
+    }
+    lines *= loops;
+    expected *= loops;
+
+    std::string path = std::format("/tmp/hyprwat-events-bench-{}.sock", getpid());
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, 1) < 0) {
+        std::perror("bind");
+        return 1;
+    }
+
+    // ring buffer, typed events, filtered subscriber
+    std::atomic<size_t> matched{0};
+    auto start = Clock::now();
+    std::thread server = serveOnce(listenFd, stream, loops);
+    {
+        Events events(path);
+        events.subscribe(WANTED, [&matched](const Event& ev) {
+            if (!ev.name.empty()) {
+                matched.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        events.start();
+        server.join();
+        while (matched.load() < expected) {
+            std::this_thread::yield();
+        }
+    }
+    double ringMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    server = serveOnce(listenFd, stream, loops);
+    size_t legacyMatched = legacyListen(path);
+    server.join();
+    double legacyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    close(listenFd);
+    unlink(path.c_str());
+
+    std::printf("%zu events (%zu bytes), %zu matched the subscriber\n", lines, stream.size() * loops, expected);
+    std::printf("  ring buffer:  %8.1f ms, %6.2f M events/s\n", ringMs, lines / ringMs / 1000.0);
+    std::printf("  string loop:  %8.1f ms, %6.2f M events/s (%.1fx)\n", legacyMs, lines / legacyMs / 1000.0,
+                legacyMs / ringMs);
+    return legacyMatched == expected ? 0 : 1;
+}
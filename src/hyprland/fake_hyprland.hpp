@@ -0,0 +1,395 @@
+#pragma once
+
+// a fake Hyprland for hyprland_ipc_bench: .socket.sock answers hyprctl requests from
+// fixtures and .socket2.sock carries whatever events are emitted. both live in a temp
+// XDG_RUNTIME_DIR that the constructor points the environment at, so hyprland::Control
+// and hyprland::Events find them the way they find a real instance. test-only,
+// header-only
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace hyprland {
+
+    // hyprctl -j replies shaped like the real ones, every field in its order
+    inline std::string fakeMonitors(int count) {
+        std::string out = "[";
+        for (int i = 0; i < count; ++i) {
+            out += std::format(R"({}{{
+    "id": {},
+    "name": "DP-{}",
+    "description": "Fake Monitor {}",
+    "make": "Fake",
+    "model": "Monitor",
+    "serial": "{}",
+    "width": 2560,
+    "height": 1440,
+    "refreshRate": 143.99800,
+    "x": {},
+    "y": 0,
+    "activeWorkspace": {{
+        "id": {},
+        "name": "{}"
+    }},
+    "specialWorkspace": {{
+        "id": 0,
+        "name": ""
+    }},
+    "reserved": [0, 30, 0, 0],
+    "scale": 1.00,
+    "transform": 0,
+    "focused": {},
+    "dpmsStatus": true,
+    "vrr": false,
+    "solitary": "0",
+    "activelyTearing": false,
+    "disabled": false,
+    "currentFormat": "XRGB8888",
+    "mirrorOf": "none",
+    "availableModes": ["2560x1440@143.99Hz","2560x1440@59.95Hz"]
+}})",
+                               i ? "," : "",
+                               i,
+                               i + 1,
+                               i,
+                               1000 + i,
+                               i * 2560,
+                               i + 1,
+                               i + 1,
+                               i == 0 ? "true" : "false");
+        }
+        return out + "]";
+    }
+
+    inline std::string fakeWorkspaces(int count, int monitors) {
+        std::string out = "[";
+        for (int i = 0; i < count; ++i) {
+            out += std::format(R"({}{{
+    "id": {},
+    "name": "{}",
+    "monitor": "DP-{}",
+    "monitorID": {},
+    "windows": 3,
+    "hasfullscreen": false,
+    "lastwindow": "0x55d1c1b0e0a0",
+    "lastwindowtitle": "kitty"
+}})",
+                               i ? "," : "",
+                               i + 1,
+                               i + 1,
+                               i % monitors + 1,
+                               i % monitors);
+        }
+        // the overview leaves this one out
+        out += R"(,{"id": -98, "name": "special:magic", "monitor": "DP-1", "monitorID": 0, "windows": 0})";
+        return out + "]";
+    }
+
+    inline std::string fakeClients(int count, int workspaces) {
+        static const char* apps[] = {"kitty", "firefox", "code", "org.gnome.Nautilus", "Spotify", "discord"};
+        std::string out = "[";
+        for (int i = 0; i < count; ++i) {
+            const char* app = apps[i % 6];
+            int ws = i % workspaces + 1;
+            out += std::format(R"({}{{
+    "address": "0x{:x}",
+    "mapped": true,
+    "hidden": false,
+    "at": [{}, {}],
+    "size": [{}, {}],
+    "workspace": {{
+        "id": {},
+        "name": "{}"
+    }},
+    "floating": false,
+    "pseudo": false,
+    "monitor": 0,
+    "class": "{}",
+    "title": "{} — window {}",
+    "initialClass": "{}",
+    "initialTitle": "{}",
+    "pid": {},
+    "xwayland": false,
+    "pinned": false,
+    "fullscreen": 0,
+    "fullscreenClient": 0,
+    "grouped": [],
+    "tags": [],
+    "swallowing": "0x0",
+    "focusHistoryID": {},
+    "inhibitingIdle": false,
+    "xdgTag": "",
+    "xdgDescription": "",
+    "contentType": "none"
+}})",
+                               i ? "," : "",
+                               0x55d1c1b0e0a0 + i * 0x1d0,
+                               10 + i % 40,
+                               50 + i % 30,
+                               1900 - i % 100,
+                               1020 - i % 50,
+                               ws,
+                               ws,
+                               app,
+                               app,
+                               i,
+                               app,
+                               app,
+                               1000 + i,
+                               i);
+        }
+        return out + "]";
+    }
+
+    // a busy session on socket2: window and workspace churn, each action as its v1
+    // and v2 event where Hyprland sends both
+    inline std::string fakeEventStorm(int actions) {
+        static const char* apps[] = {"kitty", "firefox", "code", "org.gnome.Nautilus"};
+        std::string out;
+        for (int i = 0; i < actions; ++i) {
+            const char* app = apps[i % 4];
+            unsigned long addr = 0x55d1c1b0e0a0 + (i % 64) * 0x1d0;
+            int ws = i % 9 + 1;
+            switch (i % 4) {
+            case 0:
+                out += std::format("workspace>>{0}\nworkspacev2>>{0},{0}\n", ws);
+                break;
+            case 1:
+                out += std::format("activewindow>>{0},{0}\nactivewindowv2>>{1:x}\n", app, addr);
+                break;
+            case 2:
+                out += std::format("windowtitle>>{0:x}\nwindowtitlev2>>{0:x},{1} - tab {2}\n", addr, app, i);
+                break;
+            default:
+                out += std::format("openwindow>>{0:x},{1},{2},{2}\nclosewindow>>{0:x}\n", addr, ws, app);
+                break;
+            }
+        }
+        return out;
+    }
+
+    // what the fake answers with
+    struct FakeFixtures {
+        std::string cursor = "100, 200";
+        std::string monitors = fakeMonitors(2);
+        std::string workspaces = fakeWorkspaces(4, 2);
+        std::string clients = fakeClients(10, 4);
+        std::string activeWorkspace = R"({"id": 1, "name": "1", "monitor": "DP-1"})";
+        bool lua = false; // answer like a Hyprland with the Lua config
+        std::chrono::microseconds latency{0}; // before every reply
+    };
+
+    class FakeHyprland {
+    public:
+        using Fixtures = FakeFixtures;
+
+        explicit FakeHyprland(Fixtures f = {}) : fixtures(std::make_shared<const Fixtures>(std::move(f))) {
+            char tmpl[] = "/tmp/hyprwat-fake-hyprland-XXXXXX";
+            if (!mkdtemp(tmpl)) {
+                throw std::runtime_error("fake hyprland: mkdtemp");
+            }
+            runtimeDir = tmpl;
+            std::string instance = std::format("fake_{}", getpid());
+            std::filesystem::create_directories(runtimeDir + "/hypr/" + instance);
+            setenv("XDG_RUNTIME_DIR", runtimeDir.c_str(), 1);
+            setenv("HYPRLAND_INSTANCE_SIGNATURE", instance.c_str(), 1);
+
+            std::string dir = runtimeDir + "/hypr/" + instance + "/";
+            controlFd = listenOn(dir + ".socket.sock");
+            eventsFd = listenOn(dir + ".socket2.sock");
+            if (pipe(stopPipe) < 0) {
+                throw std::runtime_error("fake hyprland: pipe");
+            }
+            thread = std::thread([this] { run(); });
+        }
+
+        ~FakeHyprland() {
+            char c = 0;
+            (void)!write(stopPipe[1], &c, 1);
+            thread.join();
+            for (int fd : eventClients) {
+                close(fd);
+            }
+            close(controlFd);
+            close(eventsFd);
+            close(stopPipe[0]);
+            close(stopPipe[1]);
+            std::error_code ec;
+            std::filesystem::remove_all(runtimeDir, ec);
+        }
+
+        // replies from here on come from f
+        void setFixtures(Fixtures f) {
+            auto next = std::make_shared<const Fixtures>(std::move(f));
+            std::lock_guard<std::mutex> lock(mutex);
+            fixtures = std::move(next);
+        }
+
+        // write lines to every socket2 listener, blocking until they took it
+        void emit(const std::string& lines) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int fd : eventClients) {
+                size_t off = 0;
+                while (off < lines.size()) {
+                    ssize_t n = send(fd, lines.data() + off, lines.size() - off, MSG_NOSIGNAL);
+                    if (n <= 0) {
+                        break;
+                    }
+                    off += n;
+                }
+            }
+        }
+
+        // wait for n socket2 listeners to have connected
+        bool waitForListeners(size_t n, std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return changed.wait_for(lock, timeout, [&] { return eventClients.size() >= n; });
+        }
+
+        // every dispatch and keyword request, as received
+        std::vector<std::string> dispatched() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return dispatches;
+        }
+
+        size_t requests() const { return requestCount.load(); }
+
+    private:
+        std::shared_ptr<const Fixtures> fixtures;
+        std::string runtimeDir;
+        int controlFd = -1;
+        int eventsFd = -1;
+        int stopPipe[2] = {-1, -1};
+        std::thread thread;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<int> eventClients;
+        std::vector<std::string> dispatches;
+        std::atomic<size_t> requestCount{0};
+
+        static int listenOn(const std::string& path) {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+                throw std::runtime_error("fake hyprland: bind " + path);
+            }
+            return fd;
+        }
+
+        std::string reply(const Fixtures& fixtures, const std::string& request) {
+            if (request == "cursorpos")
+                return fixtures.cursor;
+            if (request == "j/monitors")
+                return fixtures.monitors;
+            if (request == "j/workspaces")
+                return fixtures.workspaces;
+            if (request == "j/clients")
+                return fixtures.clients;
+            if (request == "j/activeworkspace")
+                return fixtures.activeWorkspace;
+            if (request == "monitors")
+                return "Monitor DP-1 (ID 0):\n\t2560x1440@143.99800 at 0x0\n\tscale: 1.00\n";
+
+            bool dispatch = request.starts_with("dispatch ") || request.starts_with("/dispatch ") ||
+                            request.starts_with("keyword ") || request.starts_with("/keyword ");
+            if (dispatch) {
+                std::lock_guard<std::mutex> lock(mutex);
+                dispatches.push_back(request);
+            }
+            // a Lua config rejects the old syntax and says what to use instead
+            if (fixtures.lua && request.starts_with("dispatch ")) {
+                return "error: dispatchers moved to Lua, use hl.dispatch(...)";
+            }
+            return dispatch ? "ok" : "unknown request";
+        }
+
+        void serve(int fd) {
+            char buf[8192];
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) {
+                return;
+            }
+            ++requestCount;
+            std::string request(buf, n);
+            std::shared_ptr<const Fixtures> f;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                f = fixtures;
+            }
+            if (f->latency.count() > 0) {
+                std::this_thread::sleep_for(f->latency);
+            }
+
+            std::string response;
+            if (request.starts_with("[[BATCH]]")) {
+                std::string_view rest = std::string_view(request).substr(9);
+                bool first = true;
+                while (!rest.empty()) {
+                    size_t semi = rest.find(';');
+                    std::string_view cmd = rest.substr(0, semi);
+                    if (!cmd.empty()) {
+                        response += first ? "" : "\n\n\n";
+                        response += reply(*f, std::string(cmd));
+                        first = false;
+                    }
+                    rest = semi == std::string_view::npos ? std::string_view() : rest.substr(semi + 1);
+                }
+            } else {
+                response = reply(*f, request);
+            }
+
+            size_t off = 0;
+            while (off < response.size()) {
+                ssize_t w = send(fd, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+                if (w <= 0) {
+                    break;
+                }
+                off += w;
+            }
+        }
+
+        // one request at a time, like Hyprland answering on its main loop
+        void run() {
+            while (true) {
+                pollfd fds[] = {{stopPipe[0], POLLIN, 0}, {controlFd, POLLIN, 0}, {eventsFd, POLLIN, 0}};
+                if (poll(fds, 3, -1) < 0 || fds[0].revents) {
+                    return;
+                }
+                if (fds[1].revents & POLLIN) {
+                    int fd = accept4(controlFd, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (fd >= 0) {
+                        serve(fd);
+                        close(fd);
+                    }
+                }
+                if (fds[2].revents & POLLIN) {
+                    int fd = accept4(eventsFd, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (fd >= 0) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        eventClients.push_back(fd);
+                        changed.notify_all();
+                    }
+                }
+            }
+        }
+    };
+
+} // namespace hyprland
@@ -0,0 +1,124 @@
+#include "hyprpaper.hpp"
+#include "../debug/log.hpp"
+#include "../debug/trace.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace hyprland {
+
+    // how long to wait for each reply. hyprpaper answers a preload only once it has decoded
+    // the full-size image, which for a 4K/8K wallpaper takes a good part of a second or more
+    static constexpr long REPLY_TIMEOUT_MS = 300;
+    static constexpr long PRELOAD_REPLY_TIMEOUT_MS = 5000;
+
+    static long replyTimeoutMs(const std::string& command) {
+        return command.starts_with("preload ") ? PRELOAD_REPLY_TIMEOUT_MS : REPLY_TIMEOUT_MS;
+    }
+
+    static int connectTo(const std::string& socketPath, long timeoutMs) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        timeval timeout{};
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_usec = (timeoutMs % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    // nullopt when the read timed out or failed
+    static std::optional<std::string> readReply(int fd) {
+        char buf[1024];
+        std::string reply;
+        for (;;) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) {
+                reply.append(buf, n);
+            } else if (n == 0) {
+                return reply;
+            } else if (errno != EINTR) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    Hyprpaper::Result Hyprpaper::setWallpaper(const std::string& path, const std::string& monitor, bool preloaded) const {
+        debug::trace::Span span("hyprpaper set wallpaper");
+        std::vector<std::string> commands;
+        if (!preloaded) {
+            commands.push_back("preload " + path);
+        }
+        commands.push_back("wallpaper " + monitor + "," + path);
+        commands.push_back("unload unused");
+        return request(commands);
+    }
+
+    Hyprpaper::Result Hyprpaper::preload(const std::string& path) const {
+        debug::trace::Span span("hyprpaper preload");
+        return request({"preload " + path});
+    }
+
+    Hyprpaper::Result Hyprpaper::unload(const std::string& path) const { return request({"unload " + path}); }
+
+    Hyprpaper::Result Hyprpaper::request(const std::vector<std::string>& commands) const {
+        if (socketPath.empty()) {
+            return Result::Unreachable;
+        }
+
+        // one connection per request, all queued up front: hyprpaper accepts them in
+        // order, so several requests cost one wait instead of a round trip each
+        std::vector<int> fds(commands.size(), -1);
+        bool delivered = true;
+        for (size_t i = 0; i < commands.size(); ++i) {
+            fds[i] = delivered ? connectTo(socketPath, replyTimeoutMs(commands[i])) : -1;
+            if (fds[i] < 0) {
+                delivered = false;
+                continue;
+            }
+            if (write(fds[i], commands[i].c_str(), commands[i].size()) != (ssize_t)commands[i].size()) {
+                delivered = false;
+            }
+        }
+
+        bool ok = delivered;
+        for (size_t i = 0; i < commands.size(); ++i) {
+            if (fds[i] < 0) {
+                continue;
+            }
+            std::optional<std::string> reply = readReply(fds[i]);
+            close(fds[i]);
+            if (!reply) {
+                if (ok) {
+                    debug::log(
+                        WARN, "hyprpaper didn't answer \"{}\" in {}ms", commands[i], replyTimeoutMs(commands[i]));
+                }
+                ok = false;
+            } else if (ok && *reply != "ok") {
+                debug::log(ERR, "hyprpaper refused \"{}\": {}", commands[i], *reply);
+                ok = false;
+            }
+        }
+        if (!delivered) {
+            return Result::Unreachable;
+        }
+        return ok ? Result::Ok : Result::Failed;
+    }
+
+} // namespace hyprland
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace hyprland {
+
+    // hyprpaper's own IPC socket, $XDG_RUNTIME_DIR/hypr/<sig>/.hyprpaper.sock, the one
+    // `hyprctl hyprpaper` talks to. hyprpaper answers a single request per connection
+    // and serves connections in the order they were made
+    class Hyprpaper {
+    public:
+        explicit Hyprpaper(const std::string& socketPath) : socketPath(socketPath) {}
+
+        enum class Result {
+            Ok,          // delivered and every command answered "ok"
+            Failed,      // delivered, but refused or not answered in time. hyprpaper may still carry it out
+            Unreachable, // no socket, or not all of the request could be written
+        };
+
+        // preload path (unless it already is), show it on monitor (every monitor when
+        // empty) and unload whatever is no longer shown
+        Result setWallpaper(const std::string& path, const std::string& monitor, bool preloaded = false) const;
+
+        // decode path into hyprpaper's memory ahead of showing it, and drop it again
+        Result preload(const std::string& path) const;
+        Result unload(const std::string& path) const;
+
+    private:
+        std::string socketPath;
+
+        Result request(const std::vector<std::string>& commands) const;
+    };
+
+} // namespace hyprland
@@ -1,8 +1,13 @@
 #include "ipc.hpp"
 #include "../debug/log.hpp"
-#include <yaml-cpp/yaml.h>
+#include "../debug/stats.hpp"
+#include "../debug/trace.hpp"
+#include "../util.hpp"
+#include "parse.hpp"
 
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <stdexcept>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -21,27 +26,68 @@ namespace hyprland {
     }
 
     // Control
-    Control::Control() : Control(getSocketPath(".socket.sock")) {}
-    Control::Control(const std::string& socketPath) : socketPath(socketPath) {}
+    Control::Control() : Control(getSocketPath(".socket.sock")) {
+        protocolCache = getSocketPath("hyprwat-protocol");
+        hyprpaper = Hyprpaper(getSocketPath(".hyprpaper.sock"));
+    }
+    Control::Control(const std::string& socketPath) : socketPath(socketPath), hyprpaper("") {}
 
     Control::~Control() {}
 
+    // the protocol can't change while the instance runs, so the probe's answer is kept
+    // next to its sockets and goes away with them
+    bool Control::readCachedProtocol() const {
+        if (protocolCache.empty()) {
+            return false;
+        }
+        std::ifstream in(protocolCache);
+        std::string protocol;
+        if (!(in >> protocol) || (protocol != "lua" && protocol != "legacy")) {
+            return false;
+        }
+        luaProtocol = protocol == "lua";
+        return true;
+    }
+
+    void Control::writeCachedProtocol() const {
+        if (protocolCache.empty()) {
+            return;
+        }
+        writeFileAtomically(protocolCache, [&](std::ostream& out) { out << (luaProtocol ? "lua" : "legacy") << '\n'; });
+    }
+
+    // the main thread, a wallpaper worker and the daemon's handlers can all get here first
+    bool Control::usesLuaProtocol() const {
+        std::lock_guard<std::mutex> lock(protocolMutex);
+        if (!luaProtocolDetected) {
+            detectLuaProtocol();
+        }
+        return luaProtocol;
+    }
+
     void Control::detectLuaProtocol() const {
-        luaProtocolDetected = true;
+        if (readCachedProtocol()) {
+            luaProtocolDetected = true;
+            return;
+        }
+
+        debug::trace::Span span("hyprland protocol probe");
         try {
             std::string response = send("dispatch workspace __hyprwat_probe__");
-            if (response.find("hl.dispatch") != std::string::npos) {
-                luaProtocol = true;
+            luaProtocol = response.find("hl.dispatch") != std::string::npos;
+            if (luaProtocol) {
                 debug::log(INFO, "Hyprland Lua IPC protocol detected");
-            } else {
-                luaProtocol = false;
             }
+            luaProtocolDetected = true;
+            writeCachedProtocol();
         } catch (...) {
-            // fallback to legacy
+            // fallback to legacy, and probe again next time
             luaProtocol = false;
         }
     }
 
+    void Control::prepareDispatch() { usesLuaProtocol(); }
+
     std::string Control::send(const std::string& command) const {
         int wfd = socket(AF_UNIX, SOCK_STREAM, 0);
         if (wfd < 0)
@@ -78,38 +124,80 @@ namespace hyprland {
         return response;
     }
 
-    Vec2 Control::cursorPos() {
-        std::string response = send("cursorpos");
-        int x = 0, y = 0;
-        if (sscanf(response.c_str(), "%d, %d", &x, &y) != 2) {
-            throw std::runtime_error("Failed to parse cursor position");
+    // [[BATCH]] replies are the single replies joined by this
+    static const std::string BATCH_DELIMITER = "\n\n\n";
+
+    std::vector<std::string> Control::sendBatch(const std::vector<std::string>& commands) const {
+        std::string request = "[[BATCH]]";
+        for (const auto& c : commands) {
+            request += c + ";";
+        }
+        std::string response = send(request);
+
+        std::vector<std::string> replies;
+        size_t start = 0;
+        while (replies.size() + 1 < commands.size()) {
+            size_t end = response.find(BATCH_DELIMITER, start);
+            if (end == std::string::npos) {
+                break;
+            }
+            replies.push_back(response.substr(start, end - start));
+            start = end + BATCH_DELIMITER.size();
         }
-        return {(float)x, (float)y};
+        replies.push_back(response.substr(start));
+
+        if (replies.size() != commands.size()) {
+            throw std::runtime_error("Unexpected [[BATCH]] reply");
+        }
+        return replies;
     }
 
-    std::vector<Monitor> Control::getMonitors() {
-        std::vector<Monitor> result;
-        std::string response = send("j/monitors");
+    Vec2 Control::cursorPos() { return parseCursorPos(send("cursorpos")); }
+
+    std::vector<Monitor> Control::getMonitors() { return parseMonitors(send("j/monitors")); }
+
+    compositor::CompositorSnapshot Control::snapshot(unsigned parts) {
+        using namespace compositor;
+
+        // one request for everything, replies come back in the same order
+        std::vector<std::string> commands;
+        if (parts & SNAPSHOT_CURSOR)
+            commands.push_back("cursorpos");
+        if (parts & SNAPSHOT_MONITORS)
+            commands.push_back("j/monitors");
+        if (parts & SNAPSHOT_WORKSPACES)
+            commands.push_back("j/workspaces");
+        if (parts & SNAPSHOT_CLIENTS)
+            commands.push_back("j/clients");
+        if (parts & SNAPSHOT_ACTIVE_WORKSPACE)
+            commands.push_back("j/activeworkspace");
+
+        CompositorSnapshot snap;
+        if (commands.empty()) {
+            return snap;
+        }
+
+        debug::trace::Span span("hyprland [[BATCH]] snapshot");
+        std::vector<std::string> replies;
         try {
-            auto node = YAML::Load(response);
-            if (node.IsSequence()) {
-                for (const auto& m : node) {
-                    Monitor monitor;
-                    monitor.id = m["id"].as<int>();
-                    monitor.name = m["name"].as<std::string>();
-                    monitor.x = m["x"].as<int>();
-                    monitor.y = m["y"].as<int>();
-                    monitor.width = m["width"].as<int>();
-                    monitor.height = m["height"].as<int>();
-                    monitor.scale = m["scale"].as<float>();
-                    monitor.focused = m["focused"].as<bool>();
-                    result.push_back(monitor);
-                }
-            }
+            replies = sendBatch(commands);
         } catch (const std::exception& e) {
-            debug::log(ERR, "Failed to parse monitors: {}", e.what());
+            debug::log(WARN, "{}, querying one by one", e.what());
+            return Compositor::snapshot(parts);
         }
-        return result;
+
+        size_t i = 0;
+        if (parts & SNAPSHOT_CURSOR)
+            snap.cursor = parseCursorPos(replies[i++]);
+        if (parts & SNAPSHOT_MONITORS)
+            snap.monitors = parseMonitors(replies[i++]);
+        if (parts & SNAPSHOT_WORKSPACES)
+            snap.workspaces = parseWorkspaces(replies[i++]);
+        if (parts & SNAPSHOT_CLIENTS)
+            snap.clients = parseClients(replies[i++]);
+        if (parts & SNAPSHOT_ACTIVE_WORKSPACE)
+            snap.activeWorkspaceId = parseActiveWorkspaceId(replies[i++]);
+        return snap;
     }
 
     std::optional<Monitor> hyprland::Control::monitorAtCursor(const Vec2& cursor) {
@@ -137,17 +225,45 @@ namespace hyprland {
         return 1.0f; // fallback
     }
 
-    void Control::setWallpaper(const std::string& path) {
-        if (!luaProtocolDetected) {
-            detectLuaProtocol();
+    void Control::setWallpaper(const std::string& path, const std::string& monitor) {
+        bool hit;
+        {
+            std::lock_guard<std::mutex> lock(preloadedMutex);
+            hit = preloaded.contains(path);
+        }
+        debug::log(INFO, "Applying wallpaper {}: preload {}", path, hit ? "hit" : "miss");
+        debug::trace::instant(hit ? "wallpaper preload hit" : "wallpaper preload miss");
+
+        Hyprpaper::Result applied;
+        {
+            static auto& hot = debug::stats::histogram("wallpaper preloaded");
+            static auto& cold = debug::stats::histogram("wallpaper cold");
+            debug::stats::Timer timer(hit ? hot : cold);
+            applied = hyprpaper.setWallpaper(path, monitor, hit);
         }
-        if (luaProtocol) {
+        if (applied != Hyprpaper::Result::Unreachable) {
+            // hyprpaper has the request and carries it out even when its answer is late,
+            // sending it again through hyprctl would only queue a second copy. "unload
+            // unused" drops every other preload with it
+            if (applied == Hyprpaper::Result::Failed) {
+                debug::log(ERR, "hyprpaper didn't confirm wallpaper {}", path);
+            }
+            std::lock_guard<std::mutex> lock(preloadedMutex);
+            preloaded.clear();
+            return;
+        }
+
+        // no hyprpaper socket: have Hyprland run hyprctl, which forks a shell and a
+        // process per request
+        debug::log(WARN, "hyprpaper socket unavailable, setting the wallpaper through hyprctl");
+        if (usesLuaProtocol()) {
             std::string response =
                 send("/dispatch hl.dsp.exec_cmd(\"hyprctl hyprpaper preload \\\"" + path + "\\\"\")");
             if (response != "ok") {
                 debug::log(ERR, "Failed to preload wallpaper: {}", response);
             }
-            response = send("/dispatch hl.dsp.exec_cmd(\"hyprctl hyprpaper wallpaper \\\", " + path + "\\\"\")");
+            response = send("/dispatch hl.dsp.exec_cmd(\"hyprctl hyprpaper wallpaper \\\"" + monitor + ", " + path +
+                            "\\\"\")");
             if (response != "ok") {
                 debug::log(ERR, "Failed to set wallpaper: {}", response);
             }
@@ -157,178 +273,50 @@ namespace hyprland {
             if (response != "ok") {
                 debug::log(ERR, "Failed to preload wallpaper: {}", response);
             }
-            response = send("/keyword exec hyprctl hyprpaper wallpaper \"," + path + "\"");
+            response = send("/keyword exec hyprctl hyprpaper wallpaper \"" + monitor + "," + path + "\"");
             if (response != "ok") {
                 debug::log(ERR, "Failed to set wallpaper: {}", response);
             }
             send("/keyword exec hyprctl hyprpaper unload unused");
         }
+        std::lock_guard<std::mutex> lock(preloadedMutex);
+        preloaded.clear();
     }
 
-    std::vector<Workspace> Control::getWorkspaces() {
-        std::vector<Workspace> result;
-        std::string response = send("j/workspaces");
-        try {
-            auto node = YAML::Load(response);
-            if (node.IsSequence()) {
-                for (const auto& w : node) {
-                    Workspace workspace;
-                    workspace.id = w["id"].as<int>();
-                    workspace.name = w["name"].as<std::string>();
-                    workspace.monitor = w["monitor"].as<std::string>();
-                    workspace.active = false; // not provided easily, hyprctl activeworkspace has it
-                    // do now show the special workspace on the overview
-                    if (workspace.name != "special:magic") {
-                        result.push_back(workspace);
-                    }
-                }
-            }
-        } catch (const std::exception& e) {
-            debug::log(ERR, "Failed to parse workspaces: {}", e.what());
+    compositor::Preload Control::preloadWallpaper(const std::string& path) {
+        Hyprpaper::Result result = hyprpaper.preload(path);
+        if (result == Hyprpaper::Result::Unreachable) {
+            return compositor::Preload::Unsupported;
         }
-        return result;
+        // a preload hyprpaper got but hasn't confirmed may still land, so unloadWallpaper
+        // has to know about it
+        std::lock_guard<std::mutex> lock(preloadedMutex);
+        preloaded.insert(path);
+        return result == Hyprpaper::Result::Ok ? compositor::Preload::Loaded : compositor::Preload::Sent;
     }
 
-    std::vector<Client> Control::getClients() {
-        std::vector<Client> result;
-        std::string response = send("j/clients");
-        try {
-            auto node = YAML::Load(response);
-            if (node.IsSequence()) {
-                for (const auto& c : node) {
-                    Client client;
-                    client.address = c["address"].as<std::string>();
-                    client.title = c["title"].as<std::string>();
-                    client.class_ = c["class"].as<std::string>();
-                    client.initialClass = c["initialClass"].as<std::string>();
-                    client.initialTitle = c["initialTitle"].as<std::string>();
-                    client.workspaceId = c["workspace"]["id"].as<int>();
-                    auto at = c["at"].as<std::vector<int>>();
-                    if (at.size() >= 2) {
-                        client.x = at[0];
-                        client.y = at[1];
-                    }
-                    auto size = c["size"].as<std::vector<int>>();
-                    if (size.size() >= 2) {
-                        client.width = size[0];
-                        client.height = size[1];
-                    }
-                    client.mapped = c["mapped"].as<bool>(true);
-                    client.hidden = c["hidden"].as<bool>(false);
-                    result.push_back(client);
-                }
+    void Control::unloadWallpaper(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(preloadedMutex);
+            if (!preloaded.erase(path)) {
+                return;
             }
-        } catch (const std::exception& e) {
-            debug::log(ERR, "Failed to parse clients: {}", e.what());
         }
-        return result;
+        hyprpaper.unload(path);
     }
 
-    int Control::getActiveWorkspaceId() {
-        std::string response = send("j/activeworkspace");
-        try {
-            auto node = YAML::Load(response);
-            if (node["id"]) {
-                return node["id"].as<int>();
-            }
-        } catch (const std::exception& e) {
-            debug::log(ERR, "Failed to parse activeworkspace: {}", e.what());
-        }
-        return -1;
-    }
+    std::vector<Workspace> Control::getWorkspaces() { return parseWorkspaces(send("j/workspaces")); }
+
+    std::vector<Client> Control::getClients() { return parseClients(send("j/clients")); }
+
+    int Control::getActiveWorkspaceId() { return parseActiveWorkspaceId(send("j/activeworkspace")); }
 
     void Control::dispatchWorkspace(int id) {
-        if (!luaProtocolDetected) {
-            detectLuaProtocol();
-        }
-        if (luaProtocol) {
+        if (usesLuaProtocol()) {
             send("/dispatch hl.dsp.focus({ workspace = \"" + std::to_string(id) + "\" })");
         } else {
             send("dispatch workspace " + std::to_string(id));
         }
     }
 
-    // Events
-
-    Events::Events() : Events(getSocketPath(".socket2.sock")) {}
-
-    Events::Events(const std::string& socketPath) : socketPath(socketPath) {}
-
-    Events::~Events() { stop(); }
-
-    void Events::start(EventCallback cb) {
-        if (running)
-            return;
-        running = true;
-        thread = std::thread(&Events::run, this, cb);
-    }
-
-    void Events::stop() {
-        if (!running) {
-            return;
-        }
-        running = false;
-
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            if (fd != -1) {
-                shutdown(fd, SHUT_RD);
-                fd = -1;
-            }
-        }
-
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
-
-    void Events::run(EventCallback cb) {
-        int localFd = socket(AF_UNIX, SOCK_STREAM, 0);
-        if (localFd < 0) {
-            debug::log(ERR, "Failed to create event socket");
-            return;
-        }
-
-        sockaddr_un addr{};
-        addr.sun_family = AF_UNIX;
-        std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
-
-        if (connect(localFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-            debug::log(ERR, "Failed to connect to event socket: {}", std::strerror(errno));
-            close(fd);
-            return;
-        }
-
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            fd = localFd;
-        }
-
-        char buf[1024];
-        std::string line;
-
-        while (running) {
-            ssize_t n = read(fd, buf, sizeof(buf));
-            if (n <= 0)
-                break; // socket closed or error
-            line.append(buf, n);
-
-            // simple line splitting
-            size_t pos;
-            while ((pos = line.find('\n')) != std::string::npos) {
-                std::string event = line.substr(0, pos);
-                line.erase(0, pos + 1);
-                if (!event.empty())
-                    cb(event);
-            }
-        }
-
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            if (fd != -1) {
-                close(fd);
-            }
-        }
-    }
-
 } // namespace hyprland
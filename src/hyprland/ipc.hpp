@@ -2,11 +2,10 @@
 
 #include "../compositor/compositor.hpp"
 #include "../vec.hpp"
-#include <atomic>
-#include <functional>
+#include "hyprpaper.hpp"
 #include <mutex>
+#include <set>
 #include <string>
-#include <thread>
 #include <vector>
 
 namespace hyprland {
@@ -28,7 +27,9 @@ namespace hyprland {
         Vec2 cursorPos() override;
         std::optional<Monitor> monitorAtCursor(const Vec2& cursor) override;
 
-        void setWallpaper(const std::string& path) override;
+        void setWallpaper(const std::string& path, const std::string& monitor) override;
+        compositor::Preload preloadWallpaper(const std::string& path) override;
+        void unloadWallpaper(const std::string& path) override;
 
         std::vector<Workspace> getWorkspaces() override;
         std::vector<Client> getClients() override;
@@ -37,37 +38,30 @@ namespace hyprland {
 
         bool supportsOverview() const override { return true; }
 
+        // settle the Lua vs legacy dispatch syntax now instead of on the first dispatch
+        void prepareDispatch() override;
+
+        // all requested parts in a single [[BATCH]] request
+        compositor::CompositorSnapshot snapshot(unsigned parts) override;
+
     private:
         std::vector<Monitor> getMonitors();
 
+        // send several commands in one [[BATCH]] request, one reply per command
+        std::vector<std::string> sendBatch(const std::vector<std::string>& commands) const;
+
         std::string socketPath;
+        std::string protocolCache; // empty when not talking to the env's instance
+        Hyprpaper hyprpaper;
+        std::mutex preloadedMutex;
+        std::set<std::string> preloaded; // in hyprpaper ahead of setWallpaper
+        mutable std::mutex protocolMutex; // guards the two flags below
         mutable bool luaProtocol = false;
         mutable bool luaProtocolDetected = false;
 
+        bool usesLuaProtocol() const;
         void detectLuaProtocol() const;
-    };
-
-    class Events {
-    public:
-        using EventCallback = std::function<void(const std::string&)>;
-
-        explicit Events();
-        explicit Events(const std::string& socketPath);
-        ~Events();
-
-        // Start listening on a background thread
-        void start(EventCallback cb);
-
-        // Stop listening
-        void stop();
-
-    private:
-        void run(EventCallback cb);
-
-        std::string socketPath;
-        std::thread thread;
-        std::atomic<bool> running{false};
-        std::mutex mtx;
-        int fd{-1};
+        bool readCachedProtocol() const;
+        void writeCachedProtocol() const;
     };
 } // namespace hyprland
@@ -0,0 +1,219 @@
+// hyprland::Control and hyprland::Events against a fake Hyprland, no compositor needed.
+// checks that requests, [[BATCH]] and both dispatch syntaxes come out right, then
+// measures request latency, j/clients decoding at 10/100/1000 clients and socket2
+// throughput, on Events' own thread and on an EventLoop. ctest runs it with --quick; run it by hand for steadier numbers.
+//
+//   hyprland_ipc_bench [--quick] [--latency US]
+
+#include "events.hpp"
+#include "fake_hyprland.hpp"
+#include "ipc.hpp"
+#include "parse.hpp"
+#include "../debug/stats.hpp"
+#include "../event_loop.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+using namespace hyprland;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+static void checkRequests() {
+    using namespace compositor;
+    {
+        FakeHyprland fake;
+        Control control;
+
+        size_t before = fake.requests();
+        auto snap = control.snapshot(SNAPSHOT_CURSOR | SNAPSHOT_MONITORS | SNAPSHOT_WORKSPACES | SNAPSHOT_CLIENTS |
+                                     SNAPSHOT_ACTIVE_WORKSPACE);
+        check(fake.requests() - before == 1, "snapshot is one [[BATCH]] request");
+        check(snap.cursor.x == 100 && snap.cursor.y == 200, "cursor position");
+        check(snap.monitors.size() == 2 && snap.monitors[0].focused, "monitors");
+        check(snap.workspaces.size() == 4, "workspaces without special:magic");
+        check(snap.clients.size() == 10 && snap.clients[3].workspaceId == 4, "clients");
+        check(snap.activeWorkspaceId == 1, "active workspace");
+        check(control.getClients().size() == 10, "j/clients on its own");
+
+        control.dispatchWorkspace(3);
+        auto sent = fake.dispatched();
+        check(sent.size() == 2 && sent[1] == "dispatch workspace 3", "legacy dispatch");
+    }
+    {
+        FakeHyprland::Fixtures lua;
+        lua.lua = true;
+        FakeHyprland fake(lua);
+        Control control;
+        control.dispatchWorkspace(3);
+        auto sent = fake.dispatched();
+        check(sent.size() == 2 && sent[1] == R"(/dispatch hl.dsp.focus({ workspace = "3" }))", "Lua dispatch");
+
+        // the probe's answer is remembered for the instance
+        Control again;
+        again.dispatchWorkspace(4);
+        check(fake.dispatched().size() == 3, "protocol cached per instance");
+    }
+}
+
+template <typename Fn> static void time(const std::string& name, int rounds, Fn fn) {
+    auto& hist = debug::stats::histogram(name);
+    for (int i = 0; i < rounds; ++i) {
+        debug::stats::Timer timer(hist);
+        fn();
+    }
+}
+
+static void measureLatency(int rounds, std::chrono::microseconds latency) {
+    using namespace compositor;
+    FakeHyprland::Fixtures fixtures;
+    fixtures.clients = fakeClients(50, 9);
+    fixtures.latency = latency;
+    FakeHyprland fake(fixtures);
+    Control control;
+
+    unsigned all = SNAPSHOT_CURSOR | SNAPSHOT_MONITORS | SNAPSHOT_WORKSPACES | SNAPSHOT_CLIENTS |
+                   SNAPSHOT_ACTIVE_WORKSPACE;
+    time("ipc cursorpos", rounds, [&] { control.cursorPos(); });
+    time("ipc j/clients x50", rounds, [&] { control.getClients(); });
+    time("ipc snapshot batch", rounds, [&] { control.snapshot(all); });
+    time("ipc snapshot 1 by 1", rounds, [&] { control.Compositor::snapshot(all); });
+}
+
+static void measureParsing(int rounds) {
+    FakeHyprland fake;
+    Control control;
+    for (int count : {10, 100, 1000}) {
+        std::string reply = fakeClients(count, 9);
+        FakeHyprland::Fixtures fixtures;
+        fixtures.clients = reply;
+        fake.setFixtures(fixtures);
+
+        int n = std::max(1, rounds * 10 / count);
+        size_t parsed = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            parsed += parseClients(reply).size();
+        }
+        double parseS = std::chrono::duration<double>(Clock::now() - start).count();
+
+        size_t fetched = 0;
+        start = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            fetched += control.getClients().size();
+        }
+        double fetchS = std::chrono::duration<double>(Clock::now() - start).count();
+
+        check(parsed == size_t(count) * n && fetched == parsed, "j/clients client count");
+        std::printf("  %4d clients (%7zu bytes): decode %7.1f us, %6.1f MB/s | over the socket %7.1f us\n",
+                    count,
+                    reply.size(),
+                    parseS / n * 1e6,
+                    reply.size() * n / parseS / 1e6,
+                    fetchS / n * 1e6);
+    }
+}
+
+// onLoop reads socket2 from an EventLoop dispatched here, the way the daemon does
+static void measureEvents(int actions, bool onLoop) {
+    FakeHyprland fake;
+    constexpr EventMask WANTED = eventMask(EventType::WORKSPACE, EventType::ACTIVE_WINDOW);
+    std::string storm = fakeEventStorm(actions);
+
+    size_t lines = 0, expected = 0;
+    for (size_t start = 0, nl; (nl = storm.find('\n', start)) != std::string::npos; start = nl + 1) {
+        ++lines;
+        expected += (eventMask(parseEvent(std::string_view(storm).substr(start, nl - start)).type) & WANTED) != 0;
+    }
+
+    std::atomic<size_t> matched{0};
+    EventLoop loop;
+    Events events;
+    events.subscribe(WANTED, [&](const Event&) { matched.fetch_add(1, std::memory_order_relaxed); });
+    if (onLoop) {
+        check(events.start(loop), "socket2 connected on the loop");
+    } else {
+        events.start();
+    }
+    check(fake.waitForListeners(1, std::chrono::seconds(5)), "socket2 listener connected");
+
+    // emit() blocks once the socket fills, so it can't run on the loop's own thread
+    auto start = Clock::now();
+    std::thread writer;
+    if (onLoop) {
+        writer = std::thread([&] { fake.emit(storm); });
+    } else {
+        fake.emit(storm);
+    }
+    auto deadline = start + std::chrono::seconds(10);
+    while (matched.load() < expected && Clock::now() < deadline) {
+        if (onLoop) {
+            loop.dispatch(10);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    events.stop();
+
+    check(matched.load() == expected, "every wanted socket2 event delivered");
+    std::printf("  %-7s %zu events (%zu bytes), %zu to the subscriber: %.1f ms, %.2f M events/s\n",
+                onLoop ? "loop" : "thread",
+                lines,
+                storm.size(),
+                expected,
+                ms,
+                lines / ms / 1000.0);
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    std::chrono::microseconds latency{0};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--latency" && i + 1 < argc) {
+            latency = std::chrono::microseconds(std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: %s [--quick] [--latency US]\n", argv[0]);
+            return 1;
+        }
+    }
+    int rounds = quick ? 100 : 2000;
+    debug::stats::enabled = true;
+
+    checkRequests();
+
+    std::printf("request latency (%d rounds, %lld us added per reply)\n", rounds, (long long)latency.count());
+    measureLatency(rounds, latency);
+    std::printf("%s", debug::stats::report().c_str());
+
+    std::printf("j/clients decoding\n");
+    measureParsing(rounds);
+
+    std::printf("socket2\n");
+    measureEvents(quick ? 20000 : 500000, false);
+    measureEvents(quick ? 20000 : 500000, true);
+
+    if (failures) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
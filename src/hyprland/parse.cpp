@@ -0,0 +1,178 @@
+#include "parse.hpp"
+#include "../compositor/json.hpp"
+#include "../debug/log.hpp"
+#include <cstdio>
+#include <stdexcept>
+
+namespace hyprland {
+
+    using compositor::Client;
+    using compositor::Monitor;
+    using compositor::Workspace;
+    using compositor::json::Reader;
+
+    Vec2 parseCursorPos(std::string_view response) {
+        int x = 0, y = 0;
+        if (sscanf(std::string(response).c_str(), "%d, %d", &x, &y) != 2) {
+            throw std::runtime_error("Failed to parse cursor position");
+        }
+        return {(float)x, (float)y};
+    }
+
+    // [x, y] pairs like "at" and "size"
+    static void readPair(Reader& r, int& a, int& b) {
+        r.beginArray();
+        int i = 0;
+        while (r.nextElement()) {
+            if (i == 0)
+                r.readInt(a);
+            else if (i == 1)
+                r.readInt(b);
+            else
+                r.skip();
+            ++i;
+        }
+    }
+
+    static Monitor readMonitor(Reader& r) {
+        Monitor monitor{};
+        r.beginObject();
+        std::string_view key;
+        while (r.nextKey(key)) {
+            if (key == "id")
+                r.readInt(monitor.id);
+            else if (key == "name")
+                r.readString(monitor.name);
+            else if (key == "x")
+                r.readInt(monitor.x);
+            else if (key == "y")
+                r.readInt(monitor.y);
+            else if (key == "width")
+                r.readInt(monitor.width);
+            else if (key == "height")
+                r.readInt(monitor.height);
+            else if (key == "scale")
+                r.readFloat(monitor.scale);
+            else if (key == "focused")
+                r.readBool(monitor.focused);
+            else
+                r.skip();
+        }
+        return monitor;
+    }
+
+    static Workspace readWorkspace(Reader& r) {
+        Workspace workspace{};
+        workspace.active = false; // not provided easily, hyprctl activeworkspace has it
+        r.beginObject();
+        std::string_view key;
+        while (r.nextKey(key)) {
+            if (key == "id")
+                r.readInt(workspace.id);
+            else if (key == "name")
+                r.readString(workspace.name);
+            else if (key == "monitor")
+                r.readString(workspace.monitor);
+            else
+                r.skip();
+        }
+        return workspace;
+    }
+
+    static Client readClient(Reader& r) {
+        Client client;
+        client.mapped = true;
+        r.beginObject();
+        std::string_view key;
+        while (r.nextKey(key)) {
+            if (key == "address") {
+                r.readString(client.address);
+            } else if (key == "title") {
+                r.readString(client.title);
+            } else if (key == "class") {
+                r.readString(client.class_);
+            } else if (key == "initialClass") {
+                r.readString(client.initialClass);
+            } else if (key == "initialTitle") {
+                r.readString(client.initialTitle);
+            } else if (key == "workspace" && r.isObject()) {
+                r.beginObject();
+                std::string_view field;
+                while (r.nextKey(field)) {
+                    if (field == "id")
+                        r.readInt(client.workspaceId);
+                    else
+                        r.skip();
+                }
+            } else if (key == "at" && r.isArray()) {
+                readPair(r, client.x, client.y);
+            } else if (key == "size" && r.isArray()) {
+                readPair(r, client.width, client.height);
+            } else if (key == "mapped") {
+                r.readBool(client.mapped);
+            } else if (key == "hidden") {
+                r.readBool(client.hidden);
+            } else {
+                r.skip();
+            }
+        }
+        return client;
+    }
+
+    // a top level array of objects, each decoded by read
+    template <typename T, typename Read>
+    static std::vector<T> readArray(std::string_view response, const char* what, Read read) {
+        std::vector<T> result;
+        try {
+            Reader r(response);
+            if (!r.isArray()) {
+                return result;
+            }
+            r.beginArray();
+            while (r.nextElement()) {
+                result.push_back(read(r));
+            }
+        } catch (const std::exception& e) {
+            debug::log(ERR, "Failed to parse {}: {}", what, e.what());
+        }
+        return result;
+    }
+
+    std::vector<Monitor> parseMonitors(std::string_view response) {
+        return readArray<Monitor>(response, "monitors", readMonitor);
+    }
+
+    std::vector<Workspace> parseWorkspaces(std::string_view response) {
+        auto result = readArray<Workspace>(response, "workspaces", readWorkspace);
+        // do now show the special workspace on the overview
+        std::erase_if(result, [](const Workspace& w) { return w.name == "special:magic"; });
+        return result;
+    }
+
+    std::vector<Client> parseClients(std::string_view response) {
+        return readArray<Client>(response, "clients", readClient);
+    }
+
+    int parseActiveWorkspaceId(std::string_view response) {
+        int id = -1;
+        try {
+            Reader r(response);
+            if (!r.isObject()) {
+                return -1;
+            }
+            r.beginObject();
+            std::string_view key;
+            while (r.nextKey(key)) {
+                if (key == "id")
+                    r.readInt(id);
+                else
+                    r.skip();
+            }
+        } catch (const std::exception& e) {
+            debug::log(ERR, "Failed to parse activeworkspace: {}", e.what());
+            return -1;
+        }
+        return id;
+    }
+
+} // namespace hyprland
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../compositor/compositor.hpp"
+#include "../vec.hpp"
+#include <string_view>
+#include <vector>
+
+namespace hyprland {
+
+    // decoders for hyprctl replies, split from the socket code so they can be run
+    // against recorded replies. the j/ ones log and return what they got on bad JSON
+    Vec2 parseCursorPos(std::string_view response);
+    std::vector<compositor::Monitor> parseMonitors(std::string_view response);
+    std::vector<compositor::Workspace> parseWorkspaces(std::string_view response);
+    std::vector<compositor::Client> parseClients(std::string_view response);
+    int parseActiveWorkspaceId(std::string_view response);
+
+} // namespace hyprland
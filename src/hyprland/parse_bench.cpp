@@ -0,0 +1,192 @@
+// j/clients decoding, the JSON reader against the yaml-cpp parsing it replaced. pass
+// recorded replies (hyprctl -j clients > clients.json); without any, a reply with
+// 200 clients shaped like hyprctl's is made up. both decoders must agree on every
+// client, and the allocation counts show what skipping unknown keys saves.
+//
+//   parse_bench [clients.json...] [--rounds N]
+
+#include "parse.hpp"
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using compositor::Client;
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// the decoder as it was before the JSON reader
+static std::vector<Client> parseClientsYaml(const std::string& response) {
+    std::vector<Client> result;
+    auto node = YAML::Load(response);
+    if (node.IsSequence()) {
+        for (const auto& c : node) {
+            Client client;
+            client.address = c["address"].as<std::string>();
+            client.title = c["title"].as<std::string>();
+            client.class_ = c["class"].as<std::string>();
+            client.initialClass = c["initialClass"].as<std::string>();
+            client.initialTitle = c["initialTitle"].as<std::string>();
+            client.workspaceId = c["workspace"]["id"].as<int>();
+            auto at = c["at"].as<std::vector<int>>();
+            if (at.size() >= 2) {
+                client.x = at[0];
+                client.y = at[1];
+            }
+            auto size = c["size"].as<std::vector<int>>();
+            if (size.size() >= 2) {
+                client.width = size[0];
+                client.height = size[1];
+            }
+            client.mapped = c["mapped"].as<bool>(true);
+            client.hidden = c["hidden"].as<bool>(false);
+            result.push_back(client);
+        }
+    }
+    return result;
+}
+
+// every field hyprctl prints for a client, in its order and layout
+static std::string syntheticClients(int count) {
+    static const char* apps[] = {"kitty", "firefox", "code", "org.gnome.Nautilus", "Spotify", "discord"};
+    std::string out = "[";
+    for (int i = 0; i < count; ++i) {
+        const char* app = apps[i % 6];
+        out += std::format(R"({}{{
+    "address": "0x{:x}",
+    "mapped": true,
+    "hidden": {},
+    "at": [{}, {}],
+    "size": [{}, {}],
+    "workspace": {{
+        "id": {},
+        "name": "{}"
+    }},
+    "floating": false,
+    "pseudo": false,
+    "monitor": {},
+    "class": "{}",
+    "title": "{} — window {} \"quoted\"",
+    "initialClass": "{}",
+    "initialTitle": "{}",
+    "pid": {},
+    "xwayland": false,
+    "pinned": false,
+    "fullscreen": 0,
+    "fullscreenClient": 0,
+    "grouped": [],
+    "tags": ["tag{}"],
+    "swallowing": "0x0",
+    "focusHistoryID": {},
+    "inhibitingIdle": false,
+    "xdgTag": "",
+    "xdgDescription": "",
+    "contentType": "none"
+}})",
+                           i ? "," : "", 0x55d1c1b0e0a0 + i * 0x1d0, i % 7 == 0 ? "true" : "false", 10 + i % 40,
+                           50 + i % 30, 1900 - i % 100, 1020 - i % 50, i % 10 + 1, i % 10 + 1, i % 2, app, app, i,
+                           app, app, 1000 + i, i % 3, i);
+    }
+    return out + "]";
+}
+
+static bool same(const std::vector<Client>& a, const std::vector<Client>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        const Client& x = a[i];
+        const Client& y = b[i];
+        if (x.address != y.address || x.title != y.title || x.class_ != y.class_ ||
+            x.initialClass != y.initialClass || x.initialTitle != y.initialTitle || x.workspaceId != y.workspaceId ||
+            x.x != y.x || x.y != y.y || x.width != y.width || x.height != y.height || x.mapped != y.mapped ||
+            x.hidden != y.hidden) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Result {
+    double medianUs;
+    size_t allocs;
+};
+
+template <typename Decode> static Result measure(int rounds, Decode decode) {
+    std::vector<double> times;
+    size_t allocs = 0;
+    for (int i = 0; i < rounds; ++i) {
+        size_t before = allocations.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        auto clients = decode();
+        times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        allocs = allocations.load(std::memory_order_relaxed) - before;
+    }
+    std::sort(times.begin(), times.end());
+    return {times[times.size() / 2], allocs};
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = 200;
+    std::vector<std::pair<std::string, std::string>> dumps;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+            continue;
+        }
+        std::ifstream in(arg);
+        if (!in) {
+            std::fprintf(stderr, "usage: %s [clients.json...] [--rounds N]\n", argv[0]);
+            return 1;
+        }
+        std::stringstream ss;
+        ss << in.rdbuf();
+        dumps.emplace_back(arg, ss.str());
+    }
+    if (dumps.empty()) {
+        dumps.emplace_back("synthetic, 200 clients", syntheticClients(200));
+    }
+    if (rounds <= 0) {
+        rounds = 1;
+    }
+
+    int status = 0;
+    for (const auto& [name, text] : dumps) {
+        auto json = hyprland::parseClients(text);
+        if (!same(json, parseClientsYaml(text))) {
+            std::fprintf(stderr, "%s: the decoders disagree\n", name.c_str());
+            status = 1;
+            continue;
+        }
+
+        Result reader = measure(rounds, [&] { return hyprland::parseClients(text); });
+        Result yaml = measure(rounds, [&] { return parseClientsYaml(text); });
+        std::printf("%s: %zu bytes, %zu clients, %d rounds\n", name.c_str(), text.size(), json.size(), rounds);
+        std::printf("  json reader: %9.1f us median, %6zu allocations\n", reader.medianUs, reader.allocs);
+        std::printf("  yaml-cpp:    %9.1f us median, %6zu allocations (%.1fx)\n", yaml.medianUs, yaml.allocs,
+                    yaml.medianUs / reader.medianUs);
+    }
+    return status;
+}
@@ -16,16 +16,42 @@ ParseResult Input::parseArgv(int argc, const char* argv[]) {
         return result;
     }
 
+    // leading options, in any order
     int argi = 1;
-    if (std::string(argv[argi]) == "--config") {
-        // --config and its value
-        if (argc <= argi + 1) {
-            debug::log(ERR, "--config flag requires a file path argument");
-            exit(1);
+    while (argi < argc) {
+        if (std::string(argv[argi]) == "--config") {
+            // --config and its value
+            if (argc <= argi + 1) {
+                throw std::runtime_error("--config flag requires a file path argument");
+            }
+            result.configFile = argv[argi + 1];
+            argi += 2;
+        } else if (std::string(argv[argi]) == "--stats") {
+            result.stats = true;
+            argi++;
+        } else if (std::string(argv[argi]) == "--trace") {
+            if (argc <= argi + 1) {
+                throw std::runtime_error("--trace flag requires a file path argument");
+            }
+            result.traceFile = argv[argi + 1];
+            argi += 2;
+        } else if (std::string(argv[argi]) == "--wallpaper-monitor") {
+            if (argc <= argi + 1) {
+                throw std::runtime_error("--wallpaper-monitor flag requires a monitor name or \"cursor\"");
+            }
+            result.wallpaperMonitor = argv[argi + 1];
+            argi += 2;
+        } else if (std::string(argv[argi]) == "--daemon") {
+            result.daemon = true;
+            argi++;
+        } else {
+            break;
         }
-        argi += 2;
-        result.configFile = argv[2];
-    } else {
+    }
+
+    // only options given, menu items come from stdin
+    if (argi >= argc) {
+        return result;
     }
 
     const char* arg = argv[argi];
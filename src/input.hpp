@@ -30,7 +30,11 @@ struct ParseResult {
     std::string hint;                               // For INPUT mode only
     std::string configPath;                         // For CUSTOM mode only
     std::string wallpaperDir;                       // For WALLPAPER mode only
+    std::string wallpaperMonitor;                   // --wallpaper-monitor: name, "cursor", or all when empty
     VolumeAction volumeAction = VolumeAction::NONE; // For VOLUME_OSD mode
+    bool stats = false;                             // --stats: dump frame timings on exit
+    std::string traceFile;                          // --trace: write a Chrome trace here
+    bool daemon = false;                            // --daemon: stay resident and serve popups
 };
 
 class Input {
@@ -43,6 +47,6 @@ public:
 
     static std::filesystem::path expandPath(const std::string& path);
 
-private:
+    // id[:display][*]
     static Choice parseLine(std::string line);
 };
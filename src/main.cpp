@@ -1,4 +1,6 @@
 #include "compositor/compositor.hpp"
+#include "compositor/fenriz.hpp"
+#include "compositor/state_model.hpp"
 #include "flows/audio_flow.hpp"
 #include "flows/custom_flow.hpp"
 #include "flows/flow.hpp"
@@ -7,14 +9,25 @@
 #include "flows/volume_flow.hpp"
 #include "flows/wallpaper_flow.hpp"
 #include "flows/wifi_flow.hpp"
+#include "hyprland/ipc.hpp"
 #include "input.hpp"
 #include "ui.hpp"
 #include "wayland/wayland.hpp"
 
 #include "daemon/daemon.hpp"
+#include "debug/stats.hpp"
+#include "debug/trace.hpp"
+#include "font/font.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <deque>
+#include <fcntl.h>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <unistd.h>
 
 void usage() {
     fprintf(stderr, R"(Usage:
@@ -27,6 +40,7 @@ void usage() {
   hyprwat --volume-down
   hyprwat --overview
   hyprwat --wallpaper <directory>
+  hyprwat --daemon
 
 Description:
   A simple Wayland panel to present selectable options or text input, connect to wifi networks, update audio sinks/sources, and more.
@@ -75,8 +89,17 @@ WALLPAPER MODE:
 OVERVIEW MODE:
     Use --overview to show a visual grid of all workspaces and windows and navigate between them.
 
+DAEMON MODE:
+    Run `hyprwat --daemon` once (e.g. exec-once) to keep Wayland, EGL, fonts and the theme
+    loaded. Any later hyprwat invocation is handed to the daemon and prints its result as
+    usual; if no daemon is running, or it is showing another popup, hyprwat runs by itself.
+
 Options:
   -h, --help        Show this help message
+  --config <file>   Use the given config file instead of ~/.config/hyprwat/hyprwat.conf
+  --stats           Print per-phase frame timings (p50/p99/max) to stderr on exit
+  --trace <file>    Write a Chrome/Perfetto trace of startup and background threads to <file>
+  --daemon          Stay resident and show popups for later hyprwat invocations
   --input [hint]    Show text input mode with optional hint text
   --password [hint] Show password input mode with optional hint text
   --wifi            Show WiFi network selection mode
@@ -85,40 +108,31 @@ Options:
   --volume-down     Adjust volume down and show centered volume HUD
   --custom <path>   Load a custom flow from the specified configuration file
   --wallpaper <dir> Select wallpapers from the specified directory and set using hyprpaper
+  --wallpaper-monitor <name>
+                    Set the wallpaper on this monitor only, "cursor" for the one under the cursor
   --overview        Show a visual workspace overview and selector
 )");
 }
 
-int main(const int argc, const char** argv) {
-
-    // check for help flag
-    if (argc == 2 && !strncmp(argv[1], "--help", strlen(argv[1]))) {
-        usage();
-        return 1;
-    }
-
-    // initialize Wayland connection
-    wl::Wayland wayland;
-
-    // setup ui with Wayland
-    UI ui(wayland);
-
-    // find cursor position for meny x/y
-    auto comp = compositor::detect();
-    if (!comp) {
-        debug::log(ERR, "No supported compositor found (need Hyprland or fenriz), aborting");
-        return 1;
+// where to open a popup
+struct Placement {
+    int x = 0, y = 0;       // cursor position local to its monitor, in wayland logical pixels
+    float scale = 1.0f;     // the monitor's (fractional) scale
+    int logicalWidth = 0;   // the output's size in compositor logical pixels
+    int logicalHeight = 0;
+};
+
+// the compositor state a command line needs: where the cursor is, and what --overview draws
+static unsigned snapshotParts(const ParseResult& args) {
+    unsigned parts = compositor::SNAPSHOT_PLACEMENT;
+    if (args.mode == InputMode::OVERVIEW) {
+        parts |= compositor::SNAPSHOT_OVERVIEW;
     }
-    Vec2 pos = comp->cursorPos();
-
-    // get the monitor the cursor is currently on
-    auto monitorAt = comp->monitorAtCursor(pos);
-    if (!monitorAt) {
-        debug::log(ERR, "Failed to find monitor at cursor, aborting");
-        return 1;
-    }
-    auto& monitor = *monitorAt;
+    return parts;
+}
 
+// where on monitor a popup opened at the cursor goes
+static Placement placeAt(const Vec2& pos, const compositor::Monitor& monitor, wl::Wayland& wayland) {
     float monitorScale = monitor.scale;
 
     // global offset of this monitor
@@ -133,88 +147,413 @@ int main(const int argc, const char** argv) {
     int waylandScale = wayland.display().getMaxScale();
     int x_physical = (int)(localX * monitorScale);
     int y_physical = (int)(localY * monitorScale);
-    int x_wayland = x_physical / waylandScale;
-    int y_wayland = y_physical / waylandScale;
 
     auto [displayWidth, displayHeight] = wayland.display().getOutputSize();
-    int logicalDisplayWidth = displayWidth / monitorScale;
-    int logicalDisplayHeight = displayHeight / monitorScale;
 
-    // parse command line arguments
-    auto args = Input::parseArgv(argc, argv);
-
-    // load config
-    Config config(args.configFile);
-
-    // initialize UI at wayland scaled cursor position
-    ui.init(x_wayland, y_wayland, monitorScale);
-
-    // apply theme to UI
-    ui.applyTheme(config);
+    Placement at;
+    at.x = x_physical / waylandScale;
+    at.y = y_physical / waylandScale;
+    at.scale = monitorScale;
+    at.logicalWidth = displayWidth / monitorScale;
+    at.logicalHeight = displayHeight / monitorScale;
+    return at;
+}
 
-    // if it's a volume operation, check single-instance
-    if (args.mode == InputMode::VOLUME_OSD) {
-        std::string cmd = (args.volumeAction == VolumeAction::UP) ? "up" : "down";
-        if (Daemon::sendCommand(cmd)) {
-            return 0; // Command sent to existing instance, exit successfully!
-        }
+// find the monitor under the cursor and where on it the popup goes
+static std::optional<Placement> locateCursor(const compositor::CompositorSnapshot& snap, wl::Wayland& wayland) {
+    auto monitor = snap.monitorAt(snap.cursor);
+    if (!monitor) {
+        return std::nullopt;
     }
+    return placeAt(snap.cursor, *monitor, wayland);
+}
 
-    Daemon daemon;
+// flows that need neither Wayland nor the compositor, so startup can build them on a
+// worker thread. nullptr for the modes that do
+static std::unique_ptr<Flow> makeDetachedFlow(const ParseResult& args) {
+    debug::trace::Span flowSpan("flow construction");
 
-    // find which flow to run
-    std::unique_ptr<Flow> flow;
-
-    // INPUT or PASSWORD mode
     switch (args.mode) {
     case InputMode::INPUT:
-        flow = std::make_unique<InputFlow>(args.hint, false);
-        break;
+        return std::make_unique<InputFlow>(args.hint, false);
     case InputMode::PASSWORD:
-        flow = std::make_unique<InputFlow>(args.hint, true);
-        break;
+        return std::make_unique<InputFlow>(args.hint, true);
     case InputMode::WIFI: {
         auto wifiFlow = std::make_unique<WifiFlow>();
         wifiFlow->start();
-        flow = std::move(wifiFlow);
-        break;
+        return wifiFlow;
     }
     case InputMode::AUDIO:
-        flow = std::make_unique<AudioFlow>();
+        return std::make_unique<AudioFlow>();
+    case InputMode::VOLUME_OSD:
+        return std::make_unique<VolumeFlow>(args.volumeAction);
+    case InputMode::CUSTOM:
+        return std::make_unique<CustomFlow>(args.configPath);
+    case InputMode::OVERVIEW:
+    case InputMode::WALLPAPER:
+        return nullptr;
+    case InputMode::MENU:
         break;
-    case InputMode::VOLUME_OSD: {
-        auto volumeFlow = std::make_unique<VolumeFlow>(args.volumeAction);
-        VolumeFlow* flowPtr = volumeFlow.get();
+    }
 
-        daemon.startServer([flowPtr](const std::string& cmd) { flowPtr->handleCommand(cmd); });
+    // use choices from argv, or an empty menu filled from stdin
+    if (args.choices.size() > 0) {
+        return std::make_unique<MenuFlow>(args.choices);
+    }
+    return std::make_unique<MenuFlow>();
+}
 
-        flow = std::move(volumeFlow);
-        break;
+// build the flow for a command line. menu items from stdin are hooked up by the caller,
+// throws if the mode can't run here. snap is what snapshotParts(args) asked for
+static std::unique_ptr<Flow> makeFlow(const ParseResult& args,
+                                      compositor::Compositor& comp,
+                                      wl::Wayland& wayland,
+                                      const Placement& at,
+                                      compositor::CompositorSnapshot snap) {
+    if (args.mode != InputMode::OVERVIEW && args.mode != InputMode::WALLPAPER) {
+        return makeDetachedFlow(args);
     }
-    case InputMode::CUSTOM:
-        flow = std::make_unique<CustomFlow>(args.configPath);
-        break;
-    case InputMode::OVERVIEW:
-        if (!comp->supportsOverview()) {
-            debug::log(ERR, "--overview is not supported on this compositor");
-            return 1;
+
+    debug::trace::Span flowSpan("flow construction");
+    if (args.mode == InputMode::OVERVIEW) {
+        if (!comp.supportsOverview()) {
+            throw std::runtime_error("--overview is not supported on this compositor");
         }
-        flow = std::make_unique<OverviewFlow>(*comp, wayland.display(), logicalDisplayWidth, logicalDisplayHeight);
-        break;
-    case InputMode::WALLPAPER:
-        flow = std::make_unique<WallpaperFlow>(*comp, args.wallpaperDir, logicalDisplayWidth, logicalDisplayHeight);
-        break;
-    case InputMode::MENU:
-        if (args.choices.size() > 0) {
-            // use choices from argv
-            flow = std::make_unique<MenuFlow>(args.choices);
-        } else {
-            // parse stdin asynchronously for choices
-            flow = std::make_unique<MenuFlow>();
+        return std::make_unique<OverviewFlow>(
+            comp, wayland.display(), at.logicalWidth, at.logicalHeight, std::move(snap));
+    }
+    std::string monitor = args.wallpaperMonitor;
+    if (monitor == "cursor") {
+        auto m = snap.monitorAt(snap.cursor);
+        monitor = m ? m->name : "";
+    } else if (!monitor.empty()) {
+        auto named = [&](const compositor::Monitor& m) { return m.name == monitor; };
+        if (std::none_of(snap.monitors.begin(), snap.monitors.end(), named)) {
+            throw std::runtime_error("No monitor named " + monitor);
+        }
+    }
+    return std::make_unique<WallpaperFlow>(comp, args.wallpaperDir, monitor, at.logicalWidth, at.logicalHeight);
+}
+
+// what startup needs from the compositor, gathered on a worker thread
+struct CompositorProbe {
+    std::unique_ptr<compositor::Compositor> comp;
+    compositor::CompositorSnapshot snap;
+};
+
+static CompositorProbe probeCompositor(const ParseResult& args) {
+    debug::trace::setThreadName("startup-compositor");
+    CompositorProbe probe;
+
+    debug::trace::Span detectSpan("compositor::detect");
+    probe.comp = compositor::detect();
+    detectSpan.end();
+    if (!probe.comp) {
+        return probe;
+    }
+
+    // so applying a selection is a single write
+    if (args.daemon || args.mode == InputMode::OVERVIEW || args.mode == InputMode::WALLPAPER) {
+        probe.comp->prepareDispatch();
+    }
+    if (args.daemon) {
+        return probe;
+    }
+
+    debug::trace::Span snapshotSpan("compositor snapshot");
+    probe.snap = probe.comp->snapshot(snapshotParts(args));
+    return probe;
+}
+
+static bool readsStdin(const ParseResult& args) { return args.mode == InputMode::MENU && args.choices.empty(); }
+
+// "up"/"down" for a volume key forwarded to the daemon, empty for anything else
+static std::string volumeCommand(const std::vector<std::string>& args) {
+    for (const auto& arg : args) {
+        if (arg == "--volume-up")
+            return "up";
+        if (arg == "--volume-down")
+            return "down";
+    }
+    return "";
+}
+
+// resident mode: keep Wayland, EGL, the font atlas, the theme and the compositor
+// connection warm, and show popups forwarded by clients (Daemon::forward) one at a time
+static int runDaemon(wl::Wayland& wayland, UI& ui, compositor::Compositor& comp) {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<Session>> pending;
+    bool busy = false;
+    VolumeFlow* activeVolume = nullptr;
+    bool wake = false; // a session was queued, only touched on the loop thread
+
+    Daemon daemon;
+    bool listening = daemon.startResident(ui.loop(), [&](std::shared_ptr<Session> session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (busy) {
+            // a volume key while the OSD is up adjusts it, anything else runs standalone
+            std::string cmd = volumeCommand(session->args);
+            if (activeVolume && !cmd.empty()) {
+                activeVolume->handleCommand(cmd);
+                session->exit(0);
+            } else {
+                session->busy();
+            }
+            return;
+        }
+        busy = true;
+        pending.push_back(std::move(session));
+        ui.loop().post([&wake] { wake = true; });
+    });
+    if (!listening) {
+        return 1;
+    }
+
+    // the daemon serves many popups, its timings are always collected for --stats
+    debug::stats::enabled = true;
+
+    // hyprland announces every change on socket2, so keep its state in memory instead
+    // of asking for it on every popup. fenriz pushes whole snapshots on its own socket
+    std::unique_ptr<compositor::StateModel> model;
+    if (dynamic_cast<hyprland::Control*>(&comp)) {
+        model = std::make_unique<compositor::StateModel>(comp);
+        if (!model->start(&ui.loop())) {
+            model.reset();
+        }
+    } else if (auto* fenriz = dynamic_cast<compositor::Fenriz*>(&comp)) {
+        fenriz->follow();
+    }
+
+    auto serve = [&](Session& session) {
+        // relative paths resolve against the client's directory, for this popup only
+        struct RestoreCwd {
+            int fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            ~RestoreCwd() {
+                if (fd >= 0) {
+                    if (fchdir(fd) != 0) {
+                        debug::log(WARN, "Failed to return to the daemon's directory");
+                    }
+                    close(fd);
+                }
+            }
+        } restoreCwd;
+        if (!session.cwd.empty() && chdir(session.cwd.c_str()) != 0) {
+            debug::log(WARN, "Failed to change to client directory {}", session.cwd);
+        }
+
+        std::vector<const char*> argv{"hyprwat"};
+        for (const auto& arg : session.args) {
+            argv.push_back(arg.c_str());
+        }
+
+        ParseResult args;
+        std::unique_ptr<Flow> flow;
+        try {
+            args = Input::parseArgv((int)argv.size(), argv.data());
+            if (args.daemon) {
+                throw std::runtime_error("a hyprwat daemon is already running");
+            }
+            auto snap = model ? model->snapshot(snapshotParts(args)) : comp.snapshot(snapshotParts(args));
+            auto at = locateCursor(snap, wayland);
+            if (!at) {
+                throw std::runtime_error("Failed to find monitor at cursor");
+            }
+            flow = makeFlow(args, comp, wayland, *at, std::move(snap));
+            ui.reset(at->x, at->y, at->scale);
+        } catch (const std::exception& e) {
+            session.writeStderr(std::string(e.what()) + "\n");
+            session.exit(1);
+            return;
+        }
+
+        if (readsStdin(args)) {
             MenuFlow* menuFlow = static_cast<MenuFlow*>(flow.get());
-            Input::parseStdin([menuFlow](Choice choice) { menuFlow->addChoice(choice); });
+            session.readStdin([menuFlow](const std::string& line) {
+                std::lock_guard<std::mutex> lock(Input::mutex);
+                menuFlow->addChoice(Input::parseLine(line));
+            });
         }
-        break;
+        if (args.mode == InputMode::VOLUME_OSD) {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeVolume = static_cast<VolumeFlow*>(flow.get());
+        }
+
+        int status = 0;
+        try {
+            ui.runFlow(*flow);
+        } catch (const std::exception& e) {
+            session.writeStderr(std::string(e.what()) + "\n");
+            status = 1;
+        }
+        std::string result = flow->getResult();
+
+        // nothing may reach the flow once it is gone; GL objects go before the surface
+        session.stopStdin();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeVolume = nullptr;
+        }
+        flow.reset();
+        ui.hide();
+
+        if (!result.empty()) {
+            session.writeStdout(result + "\n");
+        }
+        if (args.stats) {
+            session.writeStderr(debug::stats::report());
+        }
+        session.exit(status);
+    };
+
+    // everything the daemon waits on (Wayland, new clients, socket2) is on the UI's loop
+    while (ui.pump(-1)) {
+        if (!wake) {
+            continue;
+        }
+        wake = false;
+
+        std::shared_ptr<Session> session;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending.empty()) {
+                continue;
+            }
+            session = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        serve(*session);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = false;
+    }
+
+    debug::log(ERR, "Lost the Wayland connection, daemon exiting");
+    return 1;
+}
+
+int main(const int argc, const char** argv) {
+
+    // check for help flag
+    if (argc == 2 && !strncmp(argv[1], "--help", strlen(argv[1]))) {
+        usage();
+        return 1;
+    }
+
+    // parse command line arguments
+    ParseResult args;
+    try {
+        args = Input::parseArgv(argc, argv);
+    } catch (const std::exception& e) {
+        debug::log(ERR, "{}", e.what());
+        return 1;
+    }
+    debug::stats::enabled = args.stats;
+    if (!args.traceFile.empty()) {
+        debug::trace::start(args.traceFile);
+    }
+
+    // hand the popup to a resident daemon if one is running. Daemon::forward keeps
+    // --config and --trace runs local
+    if (!args.daemon) {
+        if (auto status = Daemon::forward(argc, argv)) {
+            return *status;
+        }
+    }
+
+    // a volume key while an OSD is up only has to reach it, skip the rest of startup
+    if (args.mode == InputMode::VOLUME_OSD && !args.daemon) {
+        std::string cmd = (args.volumeAction == VolumeAction::UP) ? "up" : "down";
+        if (Daemon::sendCommand(cmd)) {
+            return 0; // Command sent to existing instance, exit successfully!
+        }
+    }
+
+    // startup runs as a small dependency graph: the compositor queries, the config and
+    // font lookup, and flows that fetch their own data (NetworkManager, PipeWire, YAML)
+    // go to worker threads while this thread does the Wayland roundtrip and EGL setup.
+    // each result is joined right where it is first needed
+    auto probe = std::async(std::launch::async, [&args] { return probeCompositor(args); });
+    auto theme = std::async(std::launch::async, [&args] {
+        debug::trace::setThreadName("startup-config");
+        debug::trace::Span configSpan("config parse");
+        auto config = std::make_unique<Config>(args.configFile);
+        configSpan.end();
+        if (config->getString("theme", "font_path", "").empty()) {
+            font::defaultFontPath(); // remembered for UI::setupFont
+        }
+        return config;
+    });
+    std::future<std::unique_ptr<Flow>> detachedFlow;
+    if (!args.daemon) {
+        detachedFlow = std::async(std::launch::async, [&args] {
+            debug::trace::setThreadName("startup-flow");
+            return makeDetachedFlow(args);
+        });
+    }
+
+    // initialize Wayland connection
+    debug::trace::Span waylandSpan("wl::Wayland connect");
+    wl::Wayland wayland;
+    waylandSpan.end();
+
+    // setup ui with Wayland
+    UI ui(wayland);
+
+    CompositorProbe found;
+    std::unique_ptr<Config> config;
+    std::unique_ptr<Flow> flow;
+    std::optional<Placement> at;
+    try {
+        // EGL and ImGui only need the display, so they come up while the compositor probe runs
+        ui.init();
+
+        found = probe.get();
+        if (!found.comp) {
+            throw std::runtime_error("No supported compositor found (need Hyprland or fenriz), aborting");
+        }
+
+        if (args.daemon) {
+            config = theme.get();
+            ui.applyTheme(*config);
+            return runDaemon(wayland, ui, *found.comp);
+        }
+
+        at = locateCursor(found.snap, wayland);
+        if (!at) {
+            throw std::runtime_error("Failed to find monitor at cursor, aborting");
+        }
+
+        // the flows that need the compositor start now, so the wallpaper scan overlaps the theme and first frame
+        if (args.mode == InputMode::OVERVIEW || args.mode == InputMode::WALLPAPER) {
+            flow = makeFlow(args, *found.comp, wayland, *at, std::move(found.snap));
+        }
+
+        // place UI at wayland scaled cursor position
+        ui.reset(at->x, at->y, at->scale);
+
+        // apply theme to UI
+        config = theme.get();
+        ui.applyTheme(*config);
+
+        if (!flow) {
+            flow = detachedFlow.get();
+        }
+    } catch (const std::exception& e) {
+        debug::log(ERR, "{}", e.what());
+        return 1;
+    }
+
+    Daemon daemon;
+
+    if (args.mode == InputMode::VOLUME_OSD) {
+        // later volume keys adjust this OSD instead of opening another
+        VolumeFlow* flowPtr = static_cast<VolumeFlow*>(flow.get());
+        daemon.startServer(ui.loop(), [flowPtr](const std::string& cmd) { flowPtr->handleCommand(cmd); });
+    } else if (readsStdin(args)) {
+        // parse stdin asynchronously for choices
+        MenuFlow* menuFlow = static_cast<MenuFlow*>(flow.get());
+        Input::parseStdin([menuFlow](Choice choice) { menuFlow->addChoice(choice); });
     }
 
     // run the flow
@@ -227,5 +566,9 @@ int main(const int argc, const char** argv) {
         std::cout.flush();
     }
 
+    if (args.stats) {
+        std::cerr << debug::stats::report();
+    }
+
     return 0;
 }
@@ -113,7 +113,10 @@ std::vector<WifiNetwork> NetworkManagerClient::listWifiNetworks() {
 // initiates scan and calls callback for each newly discovered AP
 void NetworkManagerClient::scanWifiNetworks(std::function<void(const WifiNetwork&)> callback, int timeoutSeconds) {
     // cancel the scan before the timeout with stopScanning()
-    stopScanRequest = false;
+    {
+        std::lock_guard<std::mutex> lock(scanMutex);
+        stopScanRequest = false;
+    }
 
     auto wifiDevices = getWifiDevices();
     if (wifiDevices.empty()) {
@@ -165,15 +168,18 @@ void NetworkManagerClient::scanWifiNetworks(std::function<void(const WifiNetwork
             debug::log(ERR, "RequestScan failed on device {}: {}", devicePath.c_str(), e.getMessage());
         }
 
-        // Process events until timeout
-        auto startTime = std::chrono::steady_clock::now();
-        auto timeout = std::chrono::seconds(timeoutSeconds);
+        // the async event loop delivers AccessPointAdded, wait until timeout or stopScanning()
+        std::unique_lock<std::mutex> lock(scanMutex);
+        scanStopped.wait_for(lock, std::chrono::seconds(timeoutSeconds), [this] { return stopScanRequest; });
+    }
+}
 
-        while (std::chrono::steady_clock::now() - startTime < timeout && !stopScanRequest) {
-            connection->processPendingEvent();
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
+void NetworkManagerClient::stopScanning() {
+    {
+        std::lock_guard<std::mutex> lock(scanMutex);
+        stopScanRequest = true;
     }
+    scanStopped.notify_all();
 }
 
 // connect to network
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
 #include <sdbus-c++/sdbus-c++.h>
 #include <string>
 #include <vector>
@@ -28,7 +30,7 @@ public:
     bool connectToNetwork(const std::string& ssid,
                           const std::string& password,
                           std::function<void(ConnectionState, const std::string&)> statusCallback = nullptr);
-    void stopScanning() { stopScanRequest = true; }
+    void stopScanning();
 
 private:
     std::unique_ptr<sdbus::IConnection> connection;
@@ -37,5 +39,9 @@ private:
 
     std::vector<sdbus::ObjectPath> getWifiDevices();
     std::vector<sdbus::ObjectPath> getAccessPoints(const sdbus::ObjectPath& device);
+
+    // signals arrive on sdbus's own event loop thread, the scan just waits for this
+    std::mutex scanMutex;
+    std::condition_variable scanStopped;
     bool stopScanRequest = false;
 };
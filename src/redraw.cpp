@@ -0,0 +1,26 @@
+#include "redraw.hpp"
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace redraw {
+    static int eventFd() {
+        static int efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        return efd;
+    }
+
+    void request() {
+        uint64_t one = 1;
+        if (write(eventFd(), &one, sizeof(one)) < 0) {
+            // counter saturated, a wakeup is already pending
+        }
+    }
+
+    int fd() { return eventFd(); }
+
+    void clear() {
+        uint64_t count;
+        while (read(eventFd(), &count, sizeof(count)) > 0) {
+        }
+    }
+} // namespace redraw
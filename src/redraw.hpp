@@ -0,0 +1,15 @@
+#pragma once
+
+// The render loop only draws when something changed. Anything that changes what is on
+// screen from outside the loop (stdin, NetworkManager scans, thumbnail loading, PipeWire)
+// calls request() so the loop wakes up and draws another frame.
+namespace redraw {
+    // safe to call from any thread
+    void request();
+
+    // fd that becomes readable after request(), for the render loop to poll
+    int fd();
+
+    // reset after the render loop has picked up the request
+    void clear();
+} // namespace redraw
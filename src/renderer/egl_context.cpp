@@ -80,9 +80,25 @@ namespace egl {
         }
 
         makeCurrent();
+
+        // pacing comes from wl_surface frame callbacks (see UI::run), so don't let
+        // eglSwapBuffers block waiting for its own
+        eglSwapInterval(egl_display, 0);
         return true;
     }
 
+    void Context::destroyWindowSurface() {
+        eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (egl_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(egl_display, egl_surface);
+            egl_surface = EGL_NO_SURFACE;
+        }
+        if (egl_window) {
+            wl_egl_window_destroy(egl_window);
+            egl_window = nullptr;
+        }
+    }
+
     void Context::makeCurrent() { eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context); }
 
     void Context::swapBuffers() { eglSwapBuffers(egl_display, egl_surface); }
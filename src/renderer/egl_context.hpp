@@ -16,6 +16,8 @@ namespace egl {
         ~Context();
 
         bool createWindowSurface(wl_surface* surface, int width, int height);
+        // release the window surface, keeping the context (and its GL objects) for the next one
+        void destroyWindowSurface();
         void makeCurrent();
         void swapBuffers();
         Vec2 getBufferSize() const;
@@ -1,78 +1,281 @@
 #include "ui.hpp"
+#include "debug/stats.hpp"
+#include "debug/trace.hpp"
 #include "flows/flow.hpp"
 #include "imgui_impl_opengl3.h"
+#include "redraw.hpp"
 #include "src/font/font.hpp"
 #include <GL/gl.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <sys/epoll.h>
+
+// frames drawn after every wakeup; ImGui needs a second pass for layout changes
+// (hover, size, focus) caused by the input of the first one to settle
+static constexpr int SETTLE_FRAMES = 2;
+
+// while a text field is focused wake up this often so the cursor keeps blinking
+static constexpr int CURSOR_BLINK_MS = 400;
+
+// a compositor may hold frame callbacks back for as long as the surface isn't shown
+// (occluded, output off). past this the frame is drawn anyway, so keys still get handled
+static constexpr auto FRAME_CALLBACK_TIMEOUT = std::chrono::milliseconds(250);
+
+// per-phase frame timings, reported on exit with --stats
+struct PhaseTimers {
+    debug::Histogram& waylandPrepare = debug::stats::histogram("wayland.prepare");
+    debug::Histogram& waylandRead = debug::stats::histogram("wayland.read");
+    debug::Histogram& waylandDispatch = debug::stats::histogram("wayland.dispatch");
+    debug::Histogram& frameRender = debug::stats::histogram("frame.render");
+    debug::Histogram& imguiRender = debug::stats::histogram("imgui.render");
+    debug::Histogram& glDraw = debug::stats::histogram("gl.draw");
+    debug::Histogram& eglSwap = debug::stats::histogram("egl.swap");
+    debug::Histogram& frameTotal = debug::stats::histogram("frame.total");
+};
+
+static PhaseTimers& phases() {
+    static PhaseTimers timers;
+    return timers;
+}
+
+// smallest surface we ask for, frames that report less (or nothing yet) get this
+static constexpr int MIN_WIDTH = 100;
+static constexpr int MIN_HEIGHT = 50;
+
+void UI::init() {
+    // Get the current maximum (non-fractional) scale from all outputs
+    currentScale = wayland.display().getMaxScale();
+
+    // Set up callback for dynamic scale changes
+    wayland.display().setScaleChangeCallback([this](int32_t newScale) { updateScale(newScale); });
+
+    // Initialize EGL. the window surface is created with the layer surface in run(),
+    // once the first frame has been measured
+    debug::trace::Span eglSpan("EGL init");
+    egl = std::make_unique<egl::Context>(wayland.display().display());
+    eglSpan.end();
+
+    // Initialize ImGui. the OpenGL backend needs a current context and is set up
+    // in createSurface(), nothing is rendered before that
+    debug::trace::Span imguiSpan("ImGui init");
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.ConfigFlags |= ImGuiConfigFlags_NoMouseCursorChange;
+
+    // Framebuffer scale = buffer pixels / logical points
+    io.DisplayFramebufferScale = ImVec2((float)currentScale, (float)currentScale);
 
-void UI::init(int x, int y, float scale) {
+    // Set up input handling wayland -> imgui
+    wayland.input().setIO(&io);
+}
 
-    // Create wl layer surface with small but reasonable initial size
-    // Small enough to avoid flash, large enough for ImGui to work properly
-    int initialWidth = 50;
-    int initialHeight = 50;
+void UI::reset(int x, int y, float scale) {
     initialX = x;
     initialY = y;
     currentFractionalScale = scale;
+    running = true;
+    wayland.input().reset();
+}
 
+void UI::hide() {
+    if (!surface) {
+        return;
+    }
+    egl->destroyWindowSurface();
+    surface.reset();
+    wayland.display().flush();
+}
+
+// create the layer surface at its final size and bring up EGL and the ImGui GL backend on it
+void UI::createSurface(Frame& frame, int width, int height) {
+    debug::trace::Span configureSpan("layer surface configure");
     surface = std::make_unique<wl::LayerSurface>(wayland.display().compositor(), wayland.display().layerShell());
-    surface->create(x, y, initialWidth, initialHeight);
+    surface->create(initialX, initialY, width, height);
+    placeSurface(frame);
     while (!surface->isConfigured()) {
         wayland.display().dispatch();
     }
-
-    // Get the current maximum (non-fractional) scale from all outputs
-    currentScale = wayland.display().getMaxScale();
-
-    // Set up callback for dynamic scale changes
-    wayland.display().setScaleChangeCallback([this](int32_t newScale) { updateScale(newScale); });
+    surface->takeResize(); // the first configure is applied right here
+    configureSpan.end();
 
     // Apply buffer scale for hidpi. Keep logical size for layer surface sizing,
     // but render buffers (EGL window) in pixel size.
     surface->bufferScale(currentScale);
 
-    // Initialize EGL
-    egl = std::make_unique<egl::Context>(wayland.display().display());
-
     // Create EGL window with buffer pixel size (logical * buffer_scale)
+    debug::trace::Span eglSpan("EGL window surface");
     const int buf_w = surface->width() * currentScale;
     const int buf_h = surface->height() * currentScale;
     if (!egl->createWindowSurface(surface->surface(), buf_w, buf_h)) {
         throw std::runtime_error("Failed to create EGL window surface");
     }
+    eglSpan.end();
 
     // enable blending for transparency
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Initialize ImGui
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGui_ImplOpenGL3_Init("#version 100");
+    // the GL backend lives in the EGL context, which outlives the surface in daemon mode
+    if (!glBackendReady) {
+        ImGui_ImplOpenGL3_Init("#version 100");
+        glBackendReady = true;
+    }
+
+    // Input bounds in logical units
+    wayland.input().setWindowBounds(surface->width(), surface->height());
+}
+
+ImVec2 Frame::textSize(const char* text) {
+    // ImGui::CalcTextSize() needs a window for its font size, this needs only the atlas
     ImGuiIO& io = ImGui::GetIO();
-    io.IniFilename = nullptr;
-    io.ConfigFlags |= ImGuiConfigFlags_NoMouseCursorChange;
-    // Logical size in points
-    io.DisplaySize = ImVec2((float)surface->width(), (float)surface->height());
+    ImFont* font = io.FontDefault ? io.FontDefault : io.Fonts->Fonts[0];
+    ImVec2 size = font->CalcTextSizeA(font->FontSize * io.FontGlobalScale, FLT_MAX, 0.0f, text);
+    size.x = std::floor(size.x + 0.99999f);
+    return size;
+}
 
-    // Framebuffer scale = buffer pixels / logical points
-    io.DisplayFramebufferScale = ImVec2((float)currentScale, (float)currentScale);
+// ask for a surface matching the frame's size, clamped to a usable minimum
+void UI::requestSize(Vec2 size) {
+    if (size.x <= 0 || size.y <= 0) {
+        return;
+    }
+    surface->requestSize(std::max(MIN_WIDTH, (int)size.x), std::max(MIN_HEIGHT, (int)size.y));
+}
 
-    // Set up input handling wayland -> imgui
-    wayland.input().setIO(&io);
-    // Input bounds in logical units
-    wayland.input().setWindowBounds(initialWidth, initialHeight);
+// the compositor configured a new size: resize the EGL window to match and re-place the surface
+void UI::applyResize(Frame& frame) {
+    if (egl->window()) {
+        wl_egl_window_resize(
+            egl->window(), surface->width() * currentScale, surface->height() * currentScale, 0, 0);
+    }
+    wayland.input().setWindowBounds(surface->width(), surface->height());
+    placeSurface(frame);
 }
 
-// run a single frame until it returns a result
-FrameResult UI::run(Frame& frame) {
-    FrameResult result = FrameResult::Continue();
+// position the surface the way the frame wants: next to the cursor (kept on screen) or centered
+void UI::placeSurface(Frame& frame) {
+    if (frame.shouldRepositionOnResize()) {
+        // cursor-based positioning for menus
+        // compute viewport in Hyprland logical units
+        auto [viewport_physical_w, viewport_physical_h] = wayland.display().getOutputSize();
+        int vw_hypr = (int)(viewport_physical_w / currentFractionalScale);
+        int vh_hypr = (int)(viewport_physical_h / currentFractionalScale);
+
+        // window size in Hyprland logical units
+        int width_hypr = surface->width();
+        int height_hypr = surface->height();
+
+        surface->reposition(initialX, initialY, vw_hypr, vh_hypr, width_hypr, height_hypr);
+    } else if (!frame.shouldPositionAtCursor()) {
+        // center window for non-menu frames
+        centerWindow();
+    }
+}
 
-    while (running && !surface->shouldExit()) {
-        // Process Wayland events
+UI::UI(wl::Wayland& wayland) : wayland(wayland) {
+    eventLoop.add(wayland.display().fd(), EPOLLIN, [this](uint32_t events) { waylandEvents |= events; });
+    eventLoop.add(redraw::fd(), EPOLLIN, [this](uint32_t) {
+        redraw::clear();
+        redrawRequested = true;
+    });
+    blinkTimer = eventLoop.addTimer(std::chrono::milliseconds(0), std::chrono::milliseconds(0), [this] {
+        blinked = true;
+    });
+}
+
+bool UI::pump(int timeoutMs) {
+    {
+        debug::stats::Timer t(phases().waylandPrepare);
         wayland.display().prepareRead();
         wayland.display().flush();
+    }
+
+    waylandEvents = 0;
+    bool ok = eventLoop.dispatch(timeoutMs);
+    if (waylandEvents & EPOLLIN) {
+        debug::stats::Timer t(phases().waylandRead);
         wayland.display().readEvents();
+    } else {
+        wayland.display().cancelRead();
+    }
+    {
+        debug::stats::Timer t(phases().waylandDispatch);
         wayland.display().dispatchPending();
+    }
+    return ok && !(waylandEvents & (EPOLLHUP | EPOLLERR));
+}
+
+// while a text field is focused a timer wakes the loop so the cursor keeps blinking
+void UI::setBlink(bool on) {
+    if (on == blinking) {
+        return;
+    }
+    blinking = on;
+    auto interval = std::chrono::milliseconds(on ? CURSOR_BLINK_MS : 0);
+    eventLoop.rearm(blinkTimer, interval, interval);
+}
+
+// run a single frame until it returns a result
+// frames are only drawn when there is something new to show: Wayland input, a
+// redraw::request() from a background producer, a held key/button, or a frame that
+// reports isAnimating(). Drawing is paced by wl_surface frame callbacks (or a timeout
+// when the compositor withholds them), so an idle menu sleeps in epoll_wait() instead
+// of spinning through eglSwapBuffers.
+FrameResult UI::run(Frame& frame) {
+    // size the frame before it is drawn, so the surface is created (or resized) straight
+    // to its final size instead of growing over the first few frames
+    Vec2 size = frame.preferredSize();
+    if (!surface) {
+        createSurface(frame, std::max(MIN_WIDTH, (int)size.x), std::max(MIN_HEIGHT, (int)size.y));
+    }
+    requestSize(size);
+
+    // a newly shown frame is always drawn, and starts from a clean clock
+    settleFrames = SETTLE_FRAMES;
+    animating = false;
+    lastFrameTime = {};
+
+    // the blink timer must not keep waking an idle daemon once this frame is done
+    struct StopBlink {
+        UI& ui;
+        ~StopBlink() { ui.setBlink(false); }
+    } stopBlink{*this};
+
+    FrameResult result = FrameResult::Continue();
+    auto frameWait = [this]() -> int {
+        if (!surface->framePending()) {
+            return 0;
+        }
+        auto left = FRAME_CALLBACK_TIMEOUT - surface->frameAge();
+        return std::max<int>(0, std::chrono::ceil<std::chrono::milliseconds>(left).count());
+    };
+
+    while (running && !surface->shouldExit()) {
+        bool wantFrame = settleFrames > 0 || animating || wayland.input().isHeld();
+        setBlink(!wantFrame && ImGui::GetIO().WantTextInput);
+
+        // Process Wayland events, sleeping until there is something to do. a wanted frame
+        // waits for the frame callback, or until it is overdue
+        redrawRequested = blinked = false;
+        if (!pump(wantFrame ? frameWait() : -1)) {
+            debug::log(ERR, "Lost the Wayland connection");
+            running = false;
+            return FrameResult::Cancel();
+        }
+
+        // a configure with a new size arrived, see requestSize()
+        if (surface->takeResize()) {
+            applyResize(frame);
+        }
+
+        if (redrawRequested) {
+            settleFrames = SETTLE_FRAMES;
+        } else if (blinked) {
+            settleFrames = std::max(settleFrames, 1);
+        }
 
         // Check if user clicked outside
         if (wayland.input().shouldExit()) {
@@ -80,8 +283,17 @@ FrameResult UI::run(Frame& frame) {
             return FrameResult::Cancel();
         }
 
+        wantFrame = settleFrames > 0 || animating || wayland.input().isHeld();
+        if (!wantFrame || frameWait() > 0) {
+            continue;
+        }
+
         // Render ImGui frame and get result
         result = renderFrame(frame);
+        if (settleFrames > 0) {
+            settleFrames--;
+        }
+        animating = frame.isAnimating();
 
         // If frame returned a result (not CONTINUE), exit loop
         if (result.action != FrameResult::Action::CONTINUE) {
@@ -95,8 +307,11 @@ FrameResult UI::run(Frame& frame) {
 // run a flow until completion
 void UI::runFlow(Flow& flow) {
     Frame* lastFrame = nullptr;
+    if (currentConfig) {
+        flow.applyConfig(*currentConfig);
+    }
 
-    while (!flow.isDone() && running && !surface->shouldExit()) {
+    while (!flow.isDone() && running && !(surface && surface->shouldExit())) {
         Frame* currentFrame = flow.getCurrentFrame();
         if (!currentFrame) {
             break;
@@ -120,10 +335,17 @@ void UI::runFlow(Flow& flow) {
 }
 
 FrameResult UI::renderFrame(Frame& frame) {
+    debug::stats::Timer total(phases().frameTotal);
 
     ImGuiIO& io = ImGui::GetIO();
-    io.DeltaTime = 1.0f / 60.0f;
-    // DisplaySize will be updated after potential resize
+
+    // frames are no longer evenly spaced, so feed ImGui the real time since the last one
+    auto now = std::chrono::steady_clock::now();
+    float dt = std::chrono::duration<float>(now - lastFrameTime).count();
+    io.DeltaTime = (dt > 0.0f && dt < 1.0f) ? dt : 1.0f / 60.0f;
+    lastFrameTime = now;
+    // logical size in points, the surface only changes size when configured
+    io.DisplaySize = ImVec2((float)surface->width(), (float)surface->height());
     io.DisplayFramebufferScale = ImVec2((float)currentScale, (float)currentScale);
 
     // Start ImGui frame
@@ -131,86 +353,56 @@ FrameResult UI::renderFrame(Frame& frame) {
     ImGui::NewFrame();
     ImGui::SetNextWindowPos(ImVec2(0, 0));
 
-    static Vec2 lastWindowSize;
-    static int resizeStabilityCounter = 0;
-    static int frameCount = 0;
-    frameCount++;
-
+    debug::stats::Timer frameTimer(phases().frameRender);
     FrameResult result = frame.render();
     Vec2 desiredSize = frame.getSize();
+    frameTimer.stop();
 
     // Render (but don't swap yet)
-    ImGui::Render();
-
-    const int RESIZE_STABILITY_FRAMES = (frameCount < 20) ? 0 : 3; // Resize immediately for first 20 frames
-
-    // Check if size changed
-    if (desiredSize != lastWindowSize) {
-        resizeStabilityCounter = 0; // Reset counter on size change
-        lastWindowSize = desiredSize;
-    } else {
-        resizeStabilityCounter++;
+    {
+        debug::stats::Timer t(phases().imguiRender);
+        ImGui::Render();
     }
 
-    // Resize conditions: immediately for first frames, or after stability for later frames
-    bool shouldResize = (resizeStabilityCounter >= RESIZE_STABILITY_FRAMES) &&
-                        (desiredSize.x != surface->width() || desiredSize.y != surface->height()) &&
-                        (desiredSize.x > 0 && desiredSize.y > 0);
-
-    if (shouldResize) {
-        // Clamp to reasonable bounds
-        int newWidth = std::max(100, (int)desiredSize.x);
-        int newHeight = std::max(50, (int)desiredSize.y);
-
-        surface->resize(newWidth, newHeight, *egl);
-        wayland.input().setWindowBounds(newWidth, newHeight);
-        // wayland.display().flush();
-
-        // Update display size immediately for current frame
-        io.DisplaySize = ImVec2((float)newWidth, (float)newHeight);
-
-        // reposition window based on frame preferences
-        if (frame.shouldRepositionOnResize()) {
-            // cursor-based positioning for menus
-            // compute viewport in Hyprland logical units
-            auto [viewport_physical_w, viewport_physical_h] = wayland.display().getOutputSize();
-            int vw_hypr = (int)(viewport_physical_w / currentFractionalScale);
-            int vh_hypr = (int)(viewport_physical_h / currentFractionalScale);
-
-            // window size in Hyprland logical units
-            int width_hypr = surface->width();
-            int height_hypr = surface->height();
-
-            surface->reposition(initialX, initialY, vw_hypr, vh_hypr, width_hypr, height_hypr);
-        } else if (!frame.shouldPositionAtCursor()) {
-            // center window for non-menu frames
-            centerWindow();
-        }
-    } else {
-        // Ensure DisplaySize is always current
-        io.DisplaySize = ImVec2((float)surface->width(), (float)surface->height());
-    }
+    // content changed size: negotiate a new surface size with the compositor. this frame
+    // is still drawn at the current size, the next one after the configure arrives
+    requestSize(desiredSize);
 
     // Use buffer pixel size for viewport (after any resize)
     Vec2 bufSize = egl->getBufferSize();
     glViewport(0, 0, (int)bufSize.x, (int)bufSize.y);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        debug::stats::Timer t(phases().glDraw);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
 
-    // EGL buffer swap
-    egl->swapBuffers();
+    // EGL buffer swap, asking to be told when the compositor wants the next frame
+    surface->requestFrame();
+    {
+        debug::stats::Timer t(phases().eglSwap);
+        debug::trace::Span span(firstSwapTraced ? nullptr : "first swapBuffers");
+        egl->swapBuffers();
+    }
+    firstSwapTraced = true;
 
     return result;
 }
 
 void UI::updateScale(int32_t newScale) {
 
-    if (newScale == currentScale || !surface || !egl) {
+    if (newScale == currentScale) {
         return;
     }
 
     currentScale = newScale;
+    ImGui::GetIO().DisplayFramebufferScale = ImVec2((float)currentScale, (float)currentScale);
+
+    // before the first frame the surface is simply created at this scale
+    if (!surface || !egl) {
+        return;
+    }
 
     // Update buffer scale
     surface->bufferScale(currentScale);
@@ -223,6 +415,7 @@ void UI::updateScale(int32_t newScale) {
     }
 
     // ImGui will be updated in the next renderFrame() call
+    redraw::request();
 }
 
 void UI::applyTheme(const Config& config) {
@@ -255,14 +448,36 @@ void UI::setupFont(ImGuiIO& io, const Config& config) {
     // load the user font if specified in config defaulting to fc
     std::string fontPath = config.getString("theme", "font_path", "");
     if (fontPath.empty()) {
+        debug::trace::Span span("font::defaultFontPath");
         fontPath = font::defaultFontPath();
     }
     float fontSize = config.getFloat("theme", "font_size", 14.0f);
 
+    // a font baked by an earlier start is mapped straight from the cache
+    ImFont* cached = nullptr;
     if (!fontPath.empty()) {
-        ImFont* font = io.Fonts->AddFontFromFileTTF(fontPath.c_str(), fontSize);
-        if (font)
-            io.FontDefault = font;
+        debug::trace::Span span("ImGui font atlas cache load");
+        cached = fontCache.load(io.Fonts, fontPath, fontSize);
+    }
+
+    if (cached) {
+        io.FontDefault = cached;
+    } else {
+        debug::trace::Span atlasSpan("ImGui font atlas build");
+        ImFont* font = nullptr;
+        if (!fontPath.empty()) {
+            font = io.Fonts->AddFontFromFileTTF(fontPath.c_str(), fontSize);
+            if (font)
+                io.FontDefault = font;
+        }
+        // build now rather than lazily inside the first NewFrame so the cost shows up here
+        io.Fonts->Build();
+        atlasSpan.end();
+
+        if (font) {
+            debug::trace::Span span("ImGui font atlas cache store");
+            fontCache.store(io.Fonts, font, fontPath, fontSize);
+        }
     }
 
     // hidpi handled by DisplayFramebufferScale
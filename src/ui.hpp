@@ -1,9 +1,12 @@
 #pragma once
 
 #include "config.hpp"
+#include "event_loop.hpp"
+#include "font/atlas_cache.hpp"
 #include "vec.hpp"
 #include "wayland/layer_surface.hpp"
 #include "wayland/wayland.hpp"
+#include <chrono>
 
 // result returned by a frame after user interaction
 struct FrameResult {
@@ -39,13 +42,31 @@ public:
     // whether the window should use cursor position for initial placement
     // default true for menu-like behavior, override to false for centered windows
     virtual bool shouldPositionAtCursor() const { return true; }
+
+    // the size the frame needs, worked out from its content alone without drawing anything.
+    // UI creates or resizes the surface to it before the first render()
+    virtual Vec2 preferredSize() = 0;
+
+    // the size ImGui::CalcTextSize() gives text in the default font, also outside a frame
+    static ImVec2 textSize(const char* text);
+
+    // whether the frame is mid-animation and needs another frame even without new input
+    // frames are otherwise only drawn when input arrives or redraw::request() is called
+    virtual bool isAnimating() const { return false; }
 };
 
 class UI {
 public:
-    UI(wl::Wayland& wayland) : wayland(wayland) {}
-    // x, y, scale are the compositor's scale (fractional scales are supported)
-    void init(int x, int y, float scale);
+    UI(wl::Wayland& wayland);
+    // bring up EGL and ImGui. needs only the Wayland connection, so it runs while
+    // startup is still asking the compositor where the cursor is
+    void init();
+
+    // place the next popup at x, y, scale is the compositor's scale (fractional scales are
+    // supported). the resident daemon calls this for every popup, reusing the EGL context
+    // and font atlas, and hide() takes the surface down again once its flow is done
+    void reset(int x, int y, float scale);
+    void hide();
 
     // run a single frame until it returns a result
     FrameResult run(Frame& frame);
@@ -58,10 +79,19 @@ public:
     // reposition window to center of screen
     void centerWindow();
 
+    // the loop the UI thread sleeps in. anything else that should wake this thread
+    // (daemon sockets, socket2) is added to it
+    EventLoop& loop() { return eventLoop; }
+
+    // wait up to timeoutMs (-1: until something happens) for Wayland events or anything
+    // else on the loop, and dispatch them. false once the Wayland connection is gone
+    bool pump(int timeoutMs);
+
     Config* currentConfig = nullptr;
 
 private:
     wl::Wayland& wayland;
+    EventLoop eventLoop;
     std::unique_ptr<wl::LayerSurface> surface;
     std::unique_ptr<egl::Context> egl;
     int initialX = 0, initialY = 0;
@@ -69,7 +99,25 @@ private:
     float currentFractionalScale = 1.0f;
     bool running = true;
 
+    // render-on-demand state, see run()
+    int settleFrames = 0;
+    bool animating = false;
+    std::chrono::steady_clock::time_point lastFrameTime;
+    uint32_t waylandEvents = 0; // EPOLL* bits on the display fd during the last pump()
+    bool redrawRequested = false;
+    bool blinked = false;
+    int blinkTimer = -1;
+    bool blinking = false;
+    bool firstSwapTraced = false;
+    bool glBackendReady = false;
+    font::AtlasCache fontCache; // owns the mmap'd atlas pixels once they are loaded
+
     FrameResult renderFrame(Frame& frame);
+    void createSurface(Frame& frame, int width, int height);
+    void requestSize(Vec2 size);
+    void applyResize(Frame& frame);
+    void placeSurface(Frame& frame);
     void updateScale(int32_t new_scale);
+    void setBlink(bool on);
     void setupFont(ImGuiIO& io, const Config& config);
 };
@@ -1,6 +1,10 @@
 #include "util.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <random>
 #include <sstream>
+#include <unistd.h>
 
 std::string generateUuid() {
     std::random_device rd;
@@ -18,3 +22,42 @@ std::string generateUuid() {
     }
     return ss.str();
 }
+
+void hashMix(uint64_t& h, const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+}
+
+std::string cachePath(const std::string& name) {
+    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache && *xdgCache) {
+        return std::string(xdgCache) + "/hyprwat/" + name;
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::string(home) + "/.cache/hyprwat/" + name;
+    }
+    return "";
+}
+
+bool writeFileAtomically(const std::string& path, const std::function<void(std::ostream&)>& write) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    std::string tmp = path + "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        write(out);
+        if (!out) {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
@@ -1,4 +1,24 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
 #include <string>
+
 std::string generateUuid();
+
+// FNV-1a, stable across runs unlike std::hash, for keys that end up on disk. start from
+// FNV_OFFSET and mix in every field the key depends on
+inline constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+void hashMix(uint64_t& h, const void* data, size_t size);
+template <typename T> void hashMix(uint64_t& h, const T& value) { hashMix(h, &value, sizeof(value)); }
+
+// name under $XDG_CACHE_HOME/hyprwat/, or ~/.cache/hyprwat/ without it. empty when
+// neither is set
+std::string cachePath(const std::string& name);
+
+// have write fill <path>.<pid>, then rename it over path, so a concurrent reader finds
+// the old file or the new one and never half of one. path's directory is created if
+// missing. false, with the temp file removed, if anything failed
+bool writeFileAtomically(const std::string& path, const std::function<void(std::ostream&)>& write);
@@ -0,0 +1,362 @@
+// Checks the on-disk wallpaper caches against a temp directory: the thumbnail pack's
+// append, tombstones, crash leftovers, id pairing and compaction, including a compaction
+// by another opener while this one still has the old files mapped; and the wallpaper
+// index's scan, prune and save/load.
+#undef NDEBUG // the asserts do the work here, they must survive a release build
+#include "thumbnail_pack.hpp"
+#include "wallpaper_index.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static constexpr uint64_t HEADER_SIZE = 16; // magic and id, at the start of both files
+static constexpr uint64_t INDEX_RECORD_SIZE = 24;
+
+static std::string makeTempDir() {
+    std::string path = (fs::temp_directory_path() / "hyprwat-cache-test-XXXXXX").string();
+    assert(mkdtemp(path.data()));
+    return path;
+}
+
+// a width x height tile where every byte depends on seed, so tiles can't be mixed up
+static std::vector<unsigned char> tilePixels(int width, int height, unsigned seed) {
+    std::vector<unsigned char> pixels(size_t(width) * height * 4);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = (unsigned char)(i * 31 + seed * 17);
+    }
+    return pixels;
+}
+
+static bool hasTile(ThumbnailPack& pack, uint64_t key, int width, int height, unsigned seed) {
+    ThumbnailPack::Tile tile;
+    if (!pack.find(key, tile) || tile.width != width || tile.height != height) {
+        return false;
+    }
+    auto expected = tilePixels(width, height, seed);
+    return memcmp(tile.pixels, expected.data(), expected.size()) == 0;
+}
+
+static void append(ThumbnailPack& pack, uint64_t key, int width, int height, unsigned seed) {
+    auto pixels = tilePixels(width, height, seed);
+    assert(pack.append(key, width, height, pixels.data()));
+}
+
+// appended tiles are for the next open to find, which maps them
+static void testAppendReopenFind(const std::string& dir) {
+    {
+        ThumbnailPack pack(dir, "thumbs");
+        append(pack, 1, 4, 2, 1);
+        append(pack, 2, 3, 3, 2);
+        ThumbnailPack::Tile tile;
+        assert(!pack.find(1, tile));
+        assert(pack.liveBytes() == 4 * 2 * 4 + 3 * 3 * 4);
+    }
+    ThumbnailPack pack(dir, "thumbs");
+    assert(hasTile(pack, 1, 4, 2, 1));
+    assert(hasTile(pack, 2, 3, 3, 2));
+    assert(pack.tiles().size() == 2);
+    assert(pack.staleBytes() == 0);
+}
+
+// a tombstone outlives the process, and a replaced tile leaves its old bytes stale
+static void testRemoveTombstone(const std::string& dir) {
+    {
+        ThumbnailPack pack(dir, "thumbs");
+        append(pack, 1, 2, 2, 1);
+        append(pack, 2, 2, 2, 2);
+        append(pack, 2, 2, 2, 3);
+        pack.remove(1);
+        pack.remove(42); // never stored, writes nothing
+        assert(pack.staleBytes() == 2 * 2 * 4 * 2);
+    }
+    ThumbnailPack pack(dir, "thumbs");
+    ThumbnailPack::Tile tile;
+    assert(!pack.find(1, tile));
+    assert(hasTile(pack, 2, 2, 2, 3));
+    assert(pack.tiles().size() == 1);
+    assert(pack.staleBytes() == 2 * 2 * 4 * 2);
+    assert(fs::file_size(dir + "/thumbs.index") == HEADER_SIZE + 4 * INDEX_RECORD_SIZE);
+}
+
+// a crash can leave an index record for a tile the pack never got all of
+static void testTruncatedTile(const std::string& dir) {
+    {
+        ThumbnailPack pack(dir, "thumbs");
+        append(pack, 1, 4, 4, 1);
+        append(pack, 2, 4, 4, 2);
+    }
+    uint64_t size = fs::file_size(dir + "/thumbs.pack");
+    fs::resize_file(dir + "/thumbs.pack", size - 1);
+
+    ThumbnailPack pack(dir, "thumbs");
+    ThumbnailPack::Tile tile;
+    assert(hasTile(pack, 1, 4, 4, 1));
+    assert(!pack.find(2, tile));
+    assert(pack.tiles().size() == 1);
+}
+
+// an index paired with another pack (a crash between compaction's renames) starts over
+static void testMismatchedIds(const std::string& dir) {
+    {
+        ThumbnailPack pack(dir, "thumbs");
+        append(pack, 1, 4, 4, 1);
+    }
+    int fd = open((dir + "/thumbs.index").c_str(), O_WRONLY);
+    assert(fd >= 0);
+    uint64_t otherId = 0x1234;
+    assert(pwrite(fd, &otherId, sizeof(otherId), 8) == sizeof(otherId));
+    close(fd);
+
+    ThumbnailPack pack(dir, "thumbs");
+    ThumbnailPack::Tile tile;
+    assert(!pack.find(1, tile));
+    assert(pack.tiles().empty());
+    assert(fs::file_size(dir + "/thumbs.pack") == HEADER_SIZE);
+    assert(fs::file_size(dir + "/thumbs.index") == HEADER_SIZE);
+
+    // and is usable again straight away
+    append(pack, 2, 4, 4, 2);
+    ThumbnailPack reopened(dir, "thumbs");
+    assert(hasTile(reopened, 2, 4, 4, 2));
+}
+
+// compaction keeps every live tile and only those. a second opener that still maps the
+// old pack keeps reading it, and its appends land in the compacted one
+static void testCompaction(const std::string& dir) {
+    const int side = 1024; // 4MB tiles, enough to pass COMPACT_MIN with a few
+    {
+        ThumbnailPack pack(dir, "thumbs");
+        for (unsigned key = 1; key <= 7; ++key) {
+            append(pack, key, side, side, key);
+        }
+    }
+
+    ThumbnailPack other(dir, "thumbs");
+    assert(hasTile(other, 7, side, side, 7));
+    {
+        ThumbnailPack pack(dir, "thumbs");
+        assert(!pack.compactIfNeeded()); // nothing stale yet
+        for (unsigned key = 1; key <= 5; ++key) {
+            pack.remove(key);
+        }
+        assert(pack.staleBytes() == 5ull * side * side * 4);
+        assert(pack.compactIfNeeded());
+        assert(pack.staleBytes() == 0);
+        assert(hasTile(pack, 6, side, side, 6)); // still the old mapping
+    }
+    assert(fs::file_size(dir + "/thumbs.pack") == HEADER_SIZE + 2ull * side * side * 4);
+
+    assert(hasTile(other, 7, side, side, 7));
+    append(other, 8, 4, 4, 8);
+
+    ThumbnailPack pack(dir, "thumbs");
+    ThumbnailPack::Tile tile;
+    for (unsigned key = 1; key <= 5; ++key) {
+        assert(!pack.find(key, tile));
+    }
+    assert(hasTile(pack, 6, side, side, 6));
+    assert(hasTile(pack, 7, side, side, 7));
+    assert(hasTile(pack, 8, 4, 4, 8));
+    assert(pack.tiles().size() == 3);
+}
+
+static const std::set<std::string> EXTS{".png", ".jpg"};
+
+static void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::trunc);
+    out << content;
+    assert(out);
+}
+
+// directories changed in the last two seconds are never trusted, so the tests age them
+static void setMtime(const std::string& path, int secondsAgo) {
+    timespec times[2];
+    clock_gettime(CLOCK_REALTIME, &times[0]);
+    times[0].tv_sec -= secondsAgo;
+    times[1] = times[0];
+    assert(utimensat(AT_FDCWD, path.c_str(), times, 0) == 0);
+}
+
+static uint64_t keyOf(const std::vector<IndexedFile>& files, const std::string& path) {
+    for (const auto& f : files) {
+        if (f.path == path) {
+            return f.key;
+        }
+    }
+    return 0;
+}
+
+static bool contains(const std::vector<uint64_t>& keys, uint64_t key) {
+    return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+// a wallpaper tree: root/a.png, root/notes.txt, root/sub/b.jpg
+static void makeTree(const std::string& root) {
+    fs::create_directories(root + "/sub");
+    writeFile(root + "/a.png", "a");
+    writeFile(root + "/notes.txt", "not a wallpaper");
+    writeFile(root + "/sub/b.jpg", "b");
+    setMtime(root + "/sub", 3600);
+    setMtime(root, 3600);
+}
+
+// unchanged directories come from the index without being read, and keep their keys
+static void testScanSkipsUnchanged(const std::string& dir) {
+    std::string root = dir + "/walls";
+    makeTree(root);
+    WallpaperIndex index(dir + "/index");
+
+    auto first = index.scan(root, EXTS);
+    assert(first.size() == 2);
+    assert(index.dirsRead == 2 && index.dirsSkipped == 0);
+    uint64_t a = keyOf(first, root + "/a.png");
+    uint64_t b = keyOf(first, root + "/sub/b.jpg");
+    assert(a && b && a != b);
+
+    auto second = index.scan(root + "/", EXTS);
+    assert(second.size() == 2);
+    assert(index.dirsRead == 0 && index.dirsSkipped == 2);
+    assert(keyOf(second, root + "/a.png") == a && keyOf(second, root + "/sub/b.jpg") == b);
+    assert(index.takeOrphans().empty());
+}
+
+// a directory changed within RACY_NS is read again next time even though its mtime
+// still matches, and trusted once it has aged
+static void testRacyDirectory(const std::string& dir) {
+    std::string root = dir + "/walls";
+    makeTree(root);
+    writeFile(root + "/sub/c.png", "c"); // sub's mtime is now
+
+    WallpaperIndex index(dir + "/index");
+    assert(index.scan(root, EXTS).size() == 3);
+    assert(index.dirsRead == 2);
+    assert(index.scan(root, EXTS).size() == 3);
+    assert(index.dirsRead == 1 && index.dirsSkipped == 1);
+
+    setMtime(root + "/sub", 60);
+    index.scan(root, EXTS);
+    assert(index.dirsRead == 1);
+    index.scan(root, EXTS);
+    assert(index.dirsRead == 0 && index.dirsSkipped == 2);
+}
+
+// a replaced file gets a new key, and thumbnails of replaced files and of directories
+// that are gone come back as orphans
+static void testOrphans(const std::string& dir) {
+    std::string root = dir + "/walls";
+    makeTree(root);
+    WallpaperIndex index(dir + "/index");
+    auto files = index.scan(root, EXTS);
+    uint64_t a = keyOf(files, root + "/a.png");
+    index.setThumbnail(root + "/a.png", 111, 1000);
+    index.setThumbnail(root + "/sub/b.jpg", 222, 1000);
+    index.setThumbnail(root + "/sub/b.jpg", 333, 2000); // resized, 222 is orphaned
+    assert(index.takeOrphans() == std::vector<uint64_t>{222});
+
+    fs::remove(root + "/a.png");
+    writeFile(root + "/a.png", "a, replaced");
+    fs::remove_all(root + "/sub");
+    setMtime(root, 1800);
+
+    files = index.scan(root, EXTS);
+    assert(files.size() == 1);
+    uint64_t replaced = keyOf(files, root + "/a.png");
+    assert(replaced && replaced != a);
+    auto orphans = index.takeOrphans();
+    assert(orphans.size() == 2 && contains(orphans, 111) && contains(orphans, 333));
+    assert(index.thumbnails().empty());
+}
+
+// prune forgets what went away outside the scanned root, checking files again only in
+// directories whose mtime changed
+static void testPrune(const std::string& dir) {
+    std::string kept = dir + "/kept";
+    std::string other = dir + "/other";
+    makeTree(kept);
+    makeTree(other);
+    WallpaperIndex index(dir + "/index");
+    index.scan(kept, EXTS);
+    index.scan(other, EXTS);
+    index.setThumbnail(kept + "/a.png", 1, 1000);
+    index.setThumbnail(other + "/a.png", 2, 1000);
+    index.setThumbnail(other + "/sub/b.jpg", 3, 1000);
+
+    // other/a.png edited in place: other's mtime holds, so it is trusted
+    writeFile(other + "/a.png", "edited");
+    index.prune(kept);
+    assert(index.takeOrphans().empty());
+
+    fs::remove(other + "/a.png");
+    fs::remove_all(other + "/sub");
+    index.prune(kept);
+    auto orphans = index.takeOrphans();
+    assert(orphans.size() == 2 && contains(orphans, 2) && contains(orphans, 3));
+    auto thumbs = index.thumbnails();
+    assert(thumbs.size() == 1 && thumbs.contains(1));
+}
+
+// what save writes, load reads back, and a damaged file starts over
+static void testSaveLoad(const std::string& dir) {
+    std::string root = dir + "/walls";
+    makeTree(root);
+    std::string file = dir + "/cache/index";
+    std::vector<IndexedFile> saved;
+    {
+        WallpaperIndex index(file);
+        index.load(); // missing, not an error
+        saved = index.scan(root, EXTS);
+        index.setThumbnail(root + "/a.png", 7, 1234);
+        index.save();
+    }
+
+    WallpaperIndex index(file);
+    index.load();
+    auto thumbs = index.thumbnails();
+    assert(thumbs.size() == 1 && thumbs[7] == 1234);
+    auto files = index.scan(root, EXTS);
+    assert(index.dirsRead == 0 && index.dirsSkipped == 2);
+    assert(keyOf(files, root + "/a.png") == keyOf(saved, root + "/a.png"));
+    assert(keyOf(files, root + "/sub/b.jpg") == keyOf(saved, root + "/sub/b.jpg"));
+
+    // nothing changed, nothing written
+    auto before = fs::last_write_time(file);
+    index.save();
+    assert(fs::last_write_time(file) == before);
+
+    fs::resize_file(file, fs::file_size(file) - 5);
+    WallpaperIndex damaged(file);
+    damaged.load();
+    assert(damaged.thumbnails().empty());
+    damaged.scan(root, EXTS);
+    assert(damaged.dirsRead == 2);
+}
+
+int main() {
+    std::string root = makeTempDir();
+    int n = 0;
+    auto run = [&](void (*test)(const std::string&)) { test(root + "/" + std::to_string(n++)); };
+
+    run(testAppendReopenFind);
+    run(testRemoveTombstone);
+    run(testTruncatedTile);
+    run(testMismatchedIds);
+    run(testCompaction);
+    run(testScanSkipsUnchanged);
+    run(testRacyDirectory);
+    run(testOrphans);
+    run(testPrune);
+    run(testSaveLoad);
+
+    fs::remove_all(root);
+    printf("thumbnail pack and wallpaper index tests passed\n");
+    return 0;
+}
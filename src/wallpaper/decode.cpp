@@ -0,0 +1,162 @@
+#include "decode.hpp"
+#include "../debug/log.hpp"
+
+#include <condition_variable>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+// jpeglib.h needs FILE and size_t declared first
+#include <jpeglib.h>
+#include <stb_image.h>
+
+namespace {
+
+    std::mutex budgetMutex;
+    std::condition_variable budgetFreed;
+    size_t budgetUsed = 0;
+
+    // libjpeg reports errors by calling error_exit, which exits the process by default
+    struct JpegError {
+        jpeg_error_mgr mgr;
+        jmp_buf jump;
+    };
+
+    // warnings (a truncated file still decodes) go to our log instead of stderr
+    void jpegMessage(j_common_ptr cinfo) {
+        char message[JMSG_LENGTH_MAX];
+        cinfo->err->format_message(cinfo, message);
+        debug::log(DEBUG, "libjpeg: {}", message);
+    }
+
+    void jpegErrorExit(j_common_ptr cinfo) {
+        jpegMessage(cinfo);
+        longjmp(reinterpret_cast<JpegError*>(cinfo->err)->jump, 1);
+    }
+
+    bool isJpeg(FILE* file) {
+        unsigned char magic[3];
+        bool jpeg = fread(magic, 1, 3, file) == 3 && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF;
+        rewind(file);
+        return jpeg;
+    }
+
+    // nothing with a destructor may live in here, an error longjmps out of it
+    bool decodeJpeg(FILE* file, int minWidth, int minHeight, DecodedImage& out) {
+        jpeg_decompress_struct cinfo;
+        JpegError err;
+        unsigned char* volatile pixels = nullptr; // set after setjmp, read after a longjmp
+
+        cinfo.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpegErrorExit;
+        err.mgr.output_message = jpegMessage;
+        if (setjmp(err.jump)) {
+            jpeg_destroy_decompress(&cinfo);
+            std::free(pixels);
+            return false;
+        }
+
+        jpeg_create_decompress(&cinfo);
+        jpeg_stdio_src(&cinfo, file);
+        jpeg_read_header(&cinfo, TRUE);
+
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = jpegScaleDenominator(cinfo.image_width, cinfo.image_height, minWidth, minHeight);
+        cinfo.out_color_space = JCS_EXT_RGBA;
+        jpeg_start_decompress(&cinfo);
+
+        size_t stride = size_t(cinfo.output_width) * 4;
+        pixels = static_cast<unsigned char*>(std::malloc(stride * cinfo.output_height));
+        if (!pixels) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW rows[4];
+            int n = 0;
+            for (; n < 4 && cinfo.output_scanline + n < cinfo.output_height; ++n) {
+                rows[n] = pixels + stride * (cinfo.output_scanline + n);
+            }
+            jpeg_read_scanlines(&cinfo, rows, n);
+        }
+        jpeg_finish_decompress(&cinfo);
+
+        out.width = cinfo.output_width;
+        out.height = cinfo.output_height;
+        out.pixels = {pixels, std::free};
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    // stb can't scale while decoding, the whole image is held until the caller drops it
+    bool decodeStb(FILE* file, DecodedImage& out) {
+        int width, height, ch;
+        if (!stbi_info_from_file(file, &width, &height, &ch)) {
+            return false;
+        }
+        DecodeLease lease(size_t(width) * height * 4);
+        unsigned char* pixels = stbi_load_from_file(file, &out.width, &out.height, &ch, 4);
+        if (!pixels) {
+            return false;
+        }
+        out.lease = std::move(lease);
+        out.pixels = {pixels, stbi_image_free};
+        return true;
+    }
+
+} // namespace
+
+DecodeLease::DecodeLease(size_t bytes) : bytes(bytes) {
+    std::unique_lock<std::mutex> lock(budgetMutex);
+    budgetFreed.wait(lock, [bytes] { return budgetUsed == 0 || budgetUsed + bytes <= DECODE_BUDGET_BYTES; });
+    budgetUsed += bytes;
+}
+
+DecodeLease& DecodeLease::operator=(DecodeLease&& other) noexcept {
+    if (this != &other) {
+        release();
+        bytes = other.bytes;
+        other.bytes = 0;
+    }
+    return *this;
+}
+
+DecodeLease::~DecodeLease() { release(); }
+
+void DecodeLease::release() {
+    if (bytes == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(budgetMutex);
+        budgetUsed -= bytes;
+        bytes = 0;
+    }
+    budgetFreed.notify_all();
+}
+
+int jpegScaleDenominator(int width, int height, int minWidth, int minHeight) {
+    int denom = 1;
+    // libjpeg rounds scaled sizes up
+    while (denom < 8 && (width + 2 * denom - 1) / (2 * denom) >= minWidth &&
+           (height + 2 * denom - 1) / (2 * denom) >= minHeight) {
+        denom *= 2;
+    }
+    return denom;
+}
+
+bool decodeImage(const std::string& path, int minWidth, int minHeight, DecodedImage& out) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // libjpeg-turbo can't give RGBA for CMYK/YCCK JPEGs, stb can
+    bool ok = isJpeg(file) && decodeJpeg(file, minWidth, minHeight, out);
+    if (!ok) {
+        rewind(file);
+        ok = decodeStb(file, out);
+    }
+    std::fclose(file);
+    return ok;
+}
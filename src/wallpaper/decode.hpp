@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// full-size pixels decodeImage lets exist at once across all threads, about four 8K
+// images. a decode that doesn't fit waits for others to be released, one bigger than
+// the whole budget waits to run alone
+inline constexpr size_t DECODE_BUDGET_BYTES = size_t(512) << 20;
+
+// a share of DECODE_BUDGET_BYTES, given back when it is destroyed
+class DecodeLease {
+public:
+    DecodeLease() = default;
+    explicit DecodeLease(size_t bytes); // blocks until bytes fit
+    DecodeLease(DecodeLease&& other) noexcept : bytes(other.bytes) { other.bytes = 0; }
+    DecodeLease& operator=(DecodeLease&& other) noexcept;
+    ~DecodeLease();
+
+private:
+    size_t bytes = 0;
+    void release();
+};
+
+// RGBA pixels from decodeImage
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    DecodeLease lease; // declared first, so the pixels are freed before it is returned
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels{nullptr, nullptr};
+};
+
+// decode the image at path for shrinking to minWidth x minHeight. JPEGs are scaled by
+// 1/2, 1/4 or 1/8 inside libjpeg-turbo's IDCT, as far as the result still covers the
+// target, so an 8K wallpaper never exists at full size; the other formats can't decode
+// at a reduced size and go through stb whole, within DECODE_BUDGET_BYTES, as do JPEGs
+// libjpeg-turbo can't decode to RGBA (CMYK, YCCK). false if the image can't be read
+bool decodeImage(const std::string& path, int minWidth, int minHeight, DecodedImage& out);
+
+// the largest 8/denominator power of two reduction of width x height that still covers
+// minWidth x minHeight, 1 when there is none
+int jpegScaleDenominator(int width, int height, int minWidth, int minHeight);
@@ -0,0 +1,169 @@
+// thumbnail generation from 4K and 8K wallpapers: a full stb decode before shrinking, as
+// ThumbnailCache used to, against decodeImage, which lets libjpeg-turbo scale JPEGs
+// while decoding. without --dir a corpus of photo-like JPEGs and PNGs is made in a
+// temp directory first.
+//
+//   decode_bench [--dir DIR] [--rounds N]
+
+#include "decode.hpp"
+#include "thumbnail.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <jpeglib.h>
+#include <stb_image.h>
+#include <stb_image_resize2.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+static constexpr int THUMB_W = 400;
+static constexpr int THUMB_H = 225;
+
+// smooth gradients with some grain, so neither codec gets an easy ride
+static std::vector<unsigned char> photo(int w, int h) {
+    std::vector<unsigned char> rgb(size_t(w) * h * 3);
+    uint32_t seed = 1;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            seed = seed * 1664525 + 1013904223;
+            int grain = int(seed >> 28) - 8;
+            float fx = float(x) / w, fy = float(y) / h;
+            unsigned char* p = &rgb[(size_t(y) * w + x) * 3];
+            p[0] = std::clamp(int(128 + 100 * std::sin(fx * 9 + fy * 3)) + grain, 0, 255);
+            p[1] = std::clamp(int(128 + 100 * std::sin(fy * 7 - fx * 2)) + grain, 0, 255);
+            p[2] = std::clamp(int(255 * fx * fy) + grain, 0, 255);
+        }
+    }
+    return rgb;
+}
+
+static bool writeJpeg(const std::string& path, int w, int h, const std::vector<unsigned char>& rgb) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, file);
+    cinfo.image_width = w;
+    cinfo.image_height = h;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<unsigned char*>(&rgb[size_t(cinfo.next_scanline) * w * 3]);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    std::fclose(file);
+    return true;
+}
+
+static void makeCorpus(const fs::path& dir) {
+    const struct {
+        const char* name;
+        int w, h;
+    } sizes[] = {{"4k", 3840, 2160}, {"8k", 7680, 4320}};
+    for (const auto& s : sizes) {
+        std::fprintf(stderr, "making %s corpus...\n", s.name);
+        auto rgb = photo(s.w, s.h);
+        writeJpeg((dir / (std::string(s.name) + ".jpg")).string(), s.w, s.h, rgb);
+        stbi_write_png((dir / (std::string(s.name) + ".png")).c_str(), s.w, s.h, 3, rgb.data(), s.w * 3);
+    }
+}
+
+// what ThumbnailCache::generate did before: every pixel decoded, then shrunk
+static bool fullDecode(const std::string& path, Thumbnail& out) {
+    int w, h, ch;
+    unsigned char* input = stbi_load(path.c_str(), &w, &h, &ch, 4);
+    if (!input) {
+        return false;
+    }
+    out.width = THUMB_W;
+    out.height = THUMB_H;
+    out.pixels.resize(size_t(THUMB_W) * THUMB_H * 4);
+    stbir_resize_uint8_srgb(input, w, h, w * 4, out.pixels.data(), THUMB_W, THUMB_H, THUMB_W * 4, STBIR_RGBA);
+    stbi_image_free(input);
+    return true;
+}
+
+template <typename Fn> static double medianMs(int rounds, Fn fn) {
+    std::vector<double> ms;
+    for (int i = 0; i < rounds; ++i) {
+        auto start = Clock::now();
+        if (!fn()) {
+            return -1;
+        }
+        ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir;
+    int rounds = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: %s [--dir DIR] [--rounds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    fs::path tmp = fs::temp_directory_path() / ("hyprwat-decode-bench-" + std::to_string(getpid()));
+    if (dir.empty()) {
+        fs::create_directories(tmp);
+        makeCorpus(tmp);
+        dir = tmp.string();
+    }
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file()) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    ThumbnailCache cache((tmp / "cache").string());
+    std::printf("%-24s %11s %9s %9s %7s\n", "file", "size", "full ms", "scaled ms", "speedup");
+    for (const auto& file : files) {
+        int w, h, ch;
+        if (!stbi_info(file.c_str(), &w, &h, &ch)) {
+            continue;
+        }
+        Thumbnail thumb;
+        double full = medianMs(rounds, [&] { return fullDecode(file.string(), thumb); });
+        double scaled = medianMs(rounds, [&] { return cache.generate(file.string(), THUMB_W, THUMB_H, thumb); });
+        std::printf("%-24s %5dx%-5d %9.1f %9.1f %6.1fx\n",
+                    file.filename().c_str(),
+                    w,
+                    h,
+                    full,
+                    scaled,
+                    scaled > 0 ? full / scaled : 0.0);
+    }
+
+    fs::remove_all(tmp);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "preloader.hpp"
+#include "../debug/log.hpp"
+#include "../debug/trace.hpp"
+
+#include <algorithm>
+
+WallpaperPreloader::~WallpaperPreloader() { discard(); }
+
+void WallpaperPreloader::configure(const Settings& s) {
+    std::lock_guard<std::mutex> lock(mutex);
+    settings = s;
+    settings.neighbors = std::max(0, settings.neighbors);
+    settings.max = std::max(0, settings.max);
+}
+
+void WallpaperPreloader::highlight(std::vector<std::string> paths) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped || settings.max == 0) {
+            return;
+        }
+        if (paths.size() > (size_t)settings.max) {
+            paths.resize(settings.max);
+        }
+        wanted = std::move(paths);
+        due = Clock::now() + settings.dwell;
+        ++generation;
+        if (!running) {
+            running = true;
+            worker = std::thread(&WallpaperPreloader::run, this);
+        }
+    }
+    wake.notify_all();
+}
+
+void WallpaperPreloader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        stopped = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void WallpaperPreloader::applied() {
+    std::lock_guard<std::mutex> lock(mutex);
+    loaded.clear();
+}
+
+void WallpaperPreloader::discard() {
+    stop();
+    std::vector<std::string> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        abandoned.swap(loaded);
+    }
+    for (const auto& path : abandoned) {
+        comp.unloadWallpaper(path);
+    }
+    if (!abandoned.empty()) {
+        debug::log(DEBUG, "Unloaded {} preloaded wallpapers", abandoned.size());
+    }
+}
+
+void WallpaperPreloader::run() {
+    debug::trace::setThreadName("wallpaper-preload");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (served == generation) {
+            wake.wait(lock, [this] { return !running || served != generation; });
+            continue;
+        }
+        // still browsing, wait for the highlight to settle
+        if (Clock::now() < due) {
+            wake.wait_until(lock, due, [this] { return !running; });
+            continue;
+        }
+
+        uint64_t gen = generation;
+        std::vector<std::string> paths = wanted;
+        for (const auto& path : paths) {
+            if (!running || generation != gen) {
+                break;
+            }
+            if (auto it = std::find(loaded.begin(), loaded.end(), path); it != loaded.end()) {
+                loaded.erase(it);
+                loaded.push_back(path);
+                continue;
+            }
+
+            lock.unlock();
+            compositor::Preload result = comp.preloadWallpaper(path);
+            lock.lock();
+            if (result == compositor::Preload::Unsupported) {
+                debug::log(DEBUG, "Wallpaper preloading unavailable, applying without it");
+                running = false;
+                stopped = true;
+                return;
+            }
+            // one that wasn't confirmed (unreadable, or still decoding) is skipped, but
+            // counts against the cap and is unloaded like the rest
+            if (result == compositor::Preload::Sent) {
+                debug::log(DEBUG, "Preloading wallpaper {} not confirmed, moving on", path);
+            } else {
+                debug::log(DEBUG, "Preloaded wallpaper {}", path);
+            }
+            loaded.push_back(path);
+
+            // over the cap: drop the one highlighted longest ago. wanted is never more
+            // than max, so one of the others is always outside it
+            while (loaded.size() > (size_t)settings.max) {
+                auto victim = std::find_if(loaded.begin(), loaded.end(), [&](const std::string& p) {
+                    return std::find(wanted.begin(), wanted.end(), p) == wanted.end();
+                });
+                if (victim == loaded.end()) {
+                    break;
+                }
+                std::string evicted = std::move(*victim);
+                loaded.erase(victim);
+                lock.unlock();
+                comp.unloadWallpaper(evicted);
+                lock.lock();
+            }
+        }
+        if (generation == gen) {
+            served = gen;
+        }
+    }
+}
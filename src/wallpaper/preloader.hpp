@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../compositor/compositor.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// loads the wallpaper the user is lingering on (and its neighbours) into the compositor
+// while they browse, so confirming it is a switch rather than a decode. a highlight
+// only counts once it has held for dwell; at most max wallpapers are kept preloaded,
+// the least recently highlighted going first
+class WallpaperPreloader {
+public:
+    struct Settings {
+        std::chrono::milliseconds dwell{300};
+        int neighbors = 1; // on each side of the highlighted one
+        int max = 3;       // 0 turns preloading off
+    };
+
+    explicit WallpaperPreloader(compositor::Compositor& comp) : comp(comp) {}
+    ~WallpaperPreloader();
+
+    void configure(const Settings& s);
+    const Settings& getSettings() const { return settings; }
+
+    // the highlighted wallpaper first, then its neighbours nearest first
+    void highlight(std::vector<std::string> paths);
+
+    // stop preloading, waiting for a request in flight. what is loaded stays loaded
+    void stop();
+
+    // the compositor applied a wallpaper and let go of the other preloads itself
+    void applied();
+
+    // stop and unload everything this preloaded
+    void discard();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    compositor::Compositor& comp;
+    Settings settings;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::string> wanted; // the latest highlight, nearest first
+    Clock::time_point due;           // when it has been held for dwell
+    uint64_t generation = 0;         // bumped by every highlight
+    uint64_t served = 0;             // the generation preloaded
+    std::vector<std::string> loaded; // least recently wanted first
+    bool running = false;
+    bool stopped = false;
+    std::thread worker;
+
+    void run();
+};
@@ -1,123 +1,89 @@
 #include "thumbnail.hpp"
 #include "../debug/log.hpp"
+#include "decode.hpp"
+#include "../util.hpp"
 
+#include <cstdio>
+#include <filesystem>
 #include <string>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include <stb_image_resize2.h>
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
 
-namespace fs = std::filesystem;
-
-std::string ThumbnailCache::getOrCreateThumbnail(const std::string& imagePath, int width, int height) {
-    int hashKey = hashFileKey(std::string(imagePath));
-    if (hashKey == 0) {
-        return "";
-    }
-
-    std::string thumbPath =
-        filepath_ + std::to_string(hashKey) + "_" + std::to_string(width) + "x" + std::to_string(height) + ".png";
-
-    if (fs::exists(thumbPath)) {
-        return thumbPath; // thumbnail already exists
+uint64_t ThumbnailCache::thumbnailKey(uint64_t sourceKey, int width, int height) {
+    // all three widened to 64 bits, so neither the source key nor the size loses bits
+    uint64_t key = FNV_OFFSET;
+    for (uint64_t value : {sourceKey, uint64_t(uint32_t(width)), uint64_t(uint32_t(height))}) {
+        hashMix(key, value);
     }
+    return key;
+}
 
-    // create thumbnail
-    if (resizeImage(imagePath, thumbPath, width, height)) {
-        debug::log(DEBUG, "Thumbnail created at: {}", thumbPath);
-        return thumbPath;
-    } else {
-        return ""; // error resizing image
+bool ThumbnailCache::load(uint64_t key, Thumbnail& out) {
+    ThumbnailPack::Tile tile;
+    if (!pack.find(key, tile)) {
+        return false;
     }
+    out.width = tile.width;
+    out.height = tile.height;
+    out.mapped = tile.pixels;
+
+    // start reading it in now, the upload on the render thread would fault on it
+    size_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = uintptr_t(tile.pixels) & ~(page - 1);
+    madvise((void*)start, uintptr_t(tile.pixels) + size_t(tile.width) * tile.height * 4 - start, MADV_WILLNEED);
+    return true;
 }
 
-int ThumbnailCache::hashFileKey(std::string&& path) {
-
-    fs::path file(path);
-    if (!fs::exists(file)) {
-        debug::log(ERR, "File does not exist: {}", path);
-        return 0;
+bool ThumbnailCache::generate(const std::string& imagePath, int width, int height, Thumbnail& out) {
+    // only as many pixels as the thumbnail needs, where the format allows
+    DecodedImage input;
+    if (!decodeImage(imagePath, width, height, input)) {
+        return false;
     }
 
-    // WTF: auto ftime = fs::last_write_time(file).time_since_epoch().count();
-    // auto ftime =
-    // std::chrono::duration_cast<std::chrono::seconds>(fs::last_write_time(file).time_since_epoch()).count();
-    // auto filetime = fs::last_write_time(file);
-    // std::time_t ftime = std::chrono::system_clock::to_time_t(filetime);
-
-    auto ftime = fileLastWriteTime(file);
-    auto fsize = fs::file_size(file);
-    auto fname = file.string();
-
-    debug::log(DEBUG, "Hashing file: {}, size: {}, last write time: {}", fname, fsize, ftime);
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(size_t(width) * height * 4);
 
-    std::hash<std::string> str_hash;
-    size_t h1 = str_hash(fname);
-    size_t h2 = std::hash<uintmax_t>{}(fsize);
-    size_t h3 = std::hash<decltype(ftime)>{}(ftime);
-    return h1 ^ (h2 << 1) ^ (h3 << 2);
+    // perform resizing using the srgb-aware function
+    unsigned char* result = stbir_resize_uint8_srgb(input.pixels.get(),
+                                                    input.width,
+                                                    input.height,
+                                                    input.width * 4,
+                                                    out.pixels.data(),
+                                                    width,
+                                                    height,
+                                                    width * 4,
+                                                    STBIR_RGBA);
+    return result != nullptr;
 }
 
-// unbelievable
-uint64_t ThumbnailCache::fileLastWriteTime(const fs::path& file) {
-    auto ftime_fs = fs::last_write_time(file);
-
-    // convert file_time_type to system_clock::time_point
-    auto ftime_sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-        ftime_fs - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-
-    // seconds since epoch
-    return std::chrono::duration_cast<std::chrono::seconds>(ftime_sctp.time_since_epoch()).count();
+bool ThumbnailCache::save(uint64_t key, const Thumbnail& thumb) {
+    return pack.append(key, thumb.width, thumb.height, thumb.data());
 }
 
-bool ThumbnailCache::resizeImage(std::string inPath, std::string outPath, int newW, int newH) {
-    int w, h, ch;
-    unsigned char* input = stbi_load(inPath.c_str(), &w, &h, &ch, 0);
-    if (!input) {
-        return false;
+void ThumbnailCache::removeLegacyFiles() {
+    std::error_code ec;
+    int removed = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(filepath_, ec)) {
+        // <hash>_<width>x<height>.png, or the .tmp a crash left next to one
+        std::string name = entry.path().filename().string();
+        int hash, width, height, end = 0;
+        if (sscanf(name.c_str(), "%d_%dx%d.png%n", &hash, &width, &height, &end) != 3 || end == 0 ||
+            (name.compare(end, std::string::npos, "") != 0 && name.compare(end, std::string::npos, ".tmp") != 0)) {
+            continue;
+        }
+        if (entry.is_regular_file(ec) && std::filesystem::remove(entry.path(), ec)) {
+            ++removed;
+        }
     }
-
-    std::vector<unsigned char> output(newW * newH * ch);
-
-    int inputStride = w * ch;
-    int outputStride = newW * ch;
-
-    stbir_pixel_layout layout;
-    switch (ch) {
-    case 1:
-        layout = STBIR_1CHANNEL;
-        break;
-    case 2:
-        layout = STBIR_2CHANNEL;
-        break;
-    case 3:
-        layout = STBIR_RGB;
-        break;
-    case 4:
-        layout = STBIR_RGBA;
-        break;
-    default:
-        layout = STBIR_RGB; // fallback
-        break;
+    if (removed > 0) {
+        debug::log(DEBUG, "Removed {} thumbnails left by an older version", removed);
     }
-
-    // perform resizing using the srgb-aware function
-    unsigned char* result =
-        stbir_resize_uint8_srgb(input, w, h, inputStride, output.data(), newW, newH, outputStride, layout);
-
-    if (result == nullptr) {
-        // resizing failed
-        stbi_image_free(input);
-        return false;
-    }
-
-    // save as png
-    stbi_write_png(outPath.c_str(), newW, newH, ch, output.data(), outputStride);
-
-    stbi_image_free(input);
-    return true;
-};
+}
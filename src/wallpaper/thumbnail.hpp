@@ -1,16 +1,55 @@
 #pragma once
 
-#include <filesystem>
+#include "thumbnail_pack.hpp"
 #include <string>
+#include <vector>
 
+// a thumbnail's pixels, RGBA. a new one owns them, one from the cache points into the
+// pack's mapping
+struct Thumbnail {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+    const unsigned char* mapped = nullptr;
+
+    const unsigned char* data() const { return mapped ? mapped : pixels.data(); }
+};
+
+// thumbnails are kept as raw tiles in a ThumbnailPack under cacheDir. the steps are
+// separate so WallpaperManager can run them on different threads; all of them are safe
+// to call concurrently
 class ThumbnailCache {
 public:
-    ThumbnailCache(const std::string& cacheDir) : filepath_(cacheDir) { std::filesystem::create_directories(cacheDir); }
-    std::string getOrCreateThumbnail(const std::string& imagePath, int width, int height);
+    ThumbnailCache(const std::string& cacheDir) : filepath_(cacheDir), pack(cacheDir, "thumbnails") {}
+
+    // what the width x height thumbnail of the image with WallpaperIndex key sourceKey is
+    // cached under
+    static uint64_t thumbnailKey(uint64_t sourceKey, int width, int height);
+
+    // the cached thumbnail, false if there is none yet. its pixels stay valid as long as
+    // the cache
+    bool load(uint64_t key, Thumbnail& out);
+
+    // decode imagePath and shrink it to width x height
+    bool generate(const std::string& imagePath, int width, int height, Thumbnail& out);
+
+    // add thumb to the cache under key
+    bool save(uint64_t key, const Thumbnail& thumb);
+
+    // drop the thumbnail under key
+    void forget(uint64_t key) { pack.remove(key); }
+
+    // drop the space of replaced thumbnails if there is enough of it
+    void compact() { pack.compactIfNeeded(); }
+
+    // the key and size of every cached thumbnail, and their total
+    std::vector<std::pair<uint64_t, uint64_t>> thumbnails() { return pack.tiles(); }
+    uint64_t size() { return pack.liveBytes(); }
+
+    // delete the per-wallpaper pngs that older versions kept next to the pack
+    void removeLegacyFiles();
 
 private:
     std::string filepath_;
-    int hashFileKey(std::string&& path);
-    bool resizeImage(std::string inPath, std::string outPath, int newW, int newH);
-    uint64_t fileLastWriteTime(const std::filesystem::path& file);
+    ThumbnailPack pack;
 };
@@ -0,0 +1,377 @@
+#include "thumbnail_pack.hpp"
+#include "../debug/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <random>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// a pair starting with anything else is reset when opened
+static constexpr char PACK_MAGIC[8] = {'H', 'W', 'T', 'H', 'P', 'A', 'K', '1'};
+static constexpr char INDEX_MAGIC[8] = {'H', 'W', 'T', 'H', 'I', 'D', 'X', '1'};
+
+// both files start with one. the id pairs a pack with its index, so a crash between
+// compaction's two renames can't match tiles with another pack's offsets
+struct FileHeader {
+    char magic[8];
+    uint64_t id;
+};
+
+struct IndexRecord {
+    uint64_t key;
+    uint64_t offset; // REMOVED for a tombstone
+    uint32_t width;
+    uint32_t height;
+};
+static_assert(sizeof(IndexRecord) == 24);
+
+static constexpr uint64_t REMOVED = UINT64_MAX;
+static constexpr uint32_t MAX_SIDE = 8192;
+
+static uint64_t tileBytes(uint32_t width, uint32_t height) { return uint64_t(width) * height * 4; }
+
+static bool sameFile(int fd, const std::string& path) {
+    struct stat a, b;
+    return fstat(fd, &a) == 0 && stat(path.c_str(), &b) == 0 && a.st_ino == b.st_ino && a.st_dev == b.st_dev;
+}
+
+static bool readHeader(int fd, const char (&magic)[8], uint64_t& id) {
+    FileHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, magic, 8) != 0) {
+        return false;
+    }
+    id = header.id;
+    return true;
+}
+
+static bool writeHeader(int fd, const char (&magic)[8], uint64_t id) {
+    FileHeader header;
+    memcpy(header.magic, magic, 8);
+    header.id = id;
+    return write(fd, &header, sizeof(header)) == sizeof(header);
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static uint64_t newId() { return (uint64_t(std::random_device{}()) << 32) | std::random_device{}(); }
+
+// open a pack and its index with lock on the index. compaction renames new files into
+// place, so a lock taken on a file that has since been replaced is dropped and retried
+static bool openPair(const std::string& packPath, const std::string& indexPath, int lock, int& packFd, int& indexFd) {
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        packFd = open(packPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        indexFd = open(indexPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (packFd >= 0 && indexFd >= 0 && flock(indexFd, lock) == 0 && sameFile(indexFd, indexPath) &&
+            sameFile(packFd, packPath)) {
+            return true;
+        }
+        if (packFd >= 0) {
+            close(packFd);
+        }
+        if (indexFd >= 0) {
+            close(indexFd);
+        }
+        packFd = indexFd = -1;
+    }
+    return false;
+}
+
+static void closePair(int& packFd, int& indexFd) {
+    if (packFd >= 0) {
+        close(packFd);
+    }
+    if (indexFd >= 0) {
+        close(indexFd); // drops the lock
+    }
+    packFd = indexFd = -1;
+}
+
+// write a new pack and index aside and rename them over the old pair, which processes
+// that mapped it keep reading. the caller holds the old index's exclusive lock
+static bool replacePair(const std::string& packPath,
+                        const std::string& indexPath,
+                        const std::vector<const unsigned char*>& pixels,
+                        std::vector<IndexRecord> records) {
+    std::string packTmp = packPath + ".tmp";
+    std::string indexTmp = indexPath + ".tmp";
+    int pack = open(packTmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int index = open(indexTmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    uint64_t id = newId();
+    bool ok = pack >= 0 && index >= 0 && writeHeader(pack, PACK_MAGIC, id) && writeHeader(index, INDEX_MAGIC, id);
+
+    uint64_t offset = sizeof(FileHeader);
+    for (size_t i = 0; ok && i < records.size(); ++i) {
+        uint64_t size = tileBytes(records[i].width, records[i].height);
+        ok = writeAll(pack, pixels[i], size);
+        records[i].offset = offset;
+        offset += size;
+    }
+    ok = ok && writeAll(index, records.data(), records.size() * sizeof(IndexRecord));
+    if (pack >= 0) {
+        close(pack);
+    }
+    if (index >= 0) {
+        close(index);
+    }
+
+    // the pack first: a crash in between leaves ids that don't match, and a reset
+    ok = ok && rename(packTmp.c_str(), packPath.c_str()) == 0 && rename(indexTmp.c_str(), indexPath.c_str()) == 0;
+    if (!ok) {
+        unlink(packTmp.c_str());
+        unlink(indexTmp.c_str());
+    }
+    return ok;
+}
+
+// the live tiles in an index: later records win, tombstones erase, and anything
+// pointing outside the pack (a tile cut short by a crash) is left out
+static std::unordered_map<uint64_t, IndexRecord> readIndex(int fd, uint64_t packSize) {
+    std::unordered_map<uint64_t, IndexRecord> live;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size <= sizeof(FileHeader)) {
+        return live;
+    }
+
+    size_t count = (st.st_size - sizeof(FileHeader)) / sizeof(IndexRecord);
+    std::vector<IndexRecord> records(count);
+    ssize_t want = count * sizeof(IndexRecord);
+    if (pread(fd, records.data(), want, sizeof(FileHeader)) != want) {
+        return live;
+    }
+
+    for (const auto& r : records) {
+        if (r.offset == REMOVED) {
+            live.erase(r.key);
+        } else if (r.width > 0 && r.height > 0 && r.width <= MAX_SIDE && r.height <= MAX_SIDE &&
+                   r.offset >= sizeof(FileHeader) && r.offset + tileBytes(r.width, r.height) <= packSize) {
+            live[r.key] = r;
+        }
+    }
+    return live;
+}
+
+ThumbnailPack::ThumbnailPack(const std::string& dir, const std::string& name)
+    : packPath(dir + "/" + name + ".pack"), indexPath(dir + "/" + name + ".index") {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (!openPair(packPath, indexPath, LOCK_EX, packFd, indexFd)) {
+        debug::log(WARN, "Failed to open thumbnail pack {}: {}", packPath, strerror(errno));
+        return;
+    }
+
+    // start over when either file is new, damaged or from another pair
+    uint64_t packId, indexId;
+    if (!readHeader(packFd, PACK_MAGIC, packId) || !readHeader(indexFd, INDEX_MAGIC, indexId) || packId != indexId) {
+        bool reset = replacePair(packPath, indexPath, {}, {});
+        closePair(packFd, indexFd);
+        if (!reset || !openPair(packPath, indexPath, LOCK_EX, packFd, indexFd)) {
+            debug::log(WARN, "Failed to reset thumbnail pack {}: {}", packPath, strerror(errno));
+            closePair(packFd, indexFd);
+            return;
+        }
+    }
+
+    struct stat st;
+    uint64_t packSize = fstat(packFd, &st) == 0 ? st.st_size : 0;
+    if (packSize > sizeof(FileHeader)) {
+        void* data = mmap(nullptr, packSize, PROT_READ, MAP_SHARED, packFd, 0);
+        if (data != MAP_FAILED) {
+            mapping = data;
+            mappingSize = packSize;
+        }
+    }
+    total = packSize > sizeof(FileHeader) ? packSize - sizeof(FileHeader) : 0;
+
+    if (mapping) {
+        for (const auto& [key, r] : readIndex(indexFd, packSize)) {
+            entries[key] = {r.offset, r.width, r.height, true};
+            live += tileBytes(r.width, r.height);
+        }
+    }
+    flock(indexFd, LOCK_UN);
+    debug::log(DEBUG, "Thumbnail pack has {} tiles, {} of {} bytes stale", entries.size(), total - live, total);
+}
+
+ThumbnailPack::~ThumbnailPack() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    closePair(packFd, indexFd);
+}
+
+// take lock on the index, following a compaction by another process if there was one
+bool ThumbnailPack::reopenIfReplaced() {
+    if (indexFd < 0) {
+        return false;
+    }
+    if (flock(indexFd, LOCK_SH) == 0 && sameFile(indexFd, indexPath) && sameFile(packFd, packPath)) {
+        return true;
+    }
+    closePair(packFd, indexFd);
+    return openPair(packPath, indexPath, LOCK_SH, packFd, indexFd);
+}
+
+bool ThumbnailPack::writeRecord(uint64_t key, uint64_t offset, uint32_t width, uint32_t height) {
+    IndexRecord record{key, offset, width, height};
+    // one small O_APPEND write, so records from other processes never interleave with it
+    return write(indexFd, &record, sizeof(record)) == sizeof(record);
+}
+
+bool ThumbnailPack::find(uint64_t key, Tile& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end() || !it->second.mapped) {
+        return false;
+    }
+    out.width = it->second.width;
+    out.height = it->second.height;
+    out.pixels = static_cast<const unsigned char*>(mapping) + it->second.offset;
+    return true;
+}
+
+bool ThumbnailPack::append(uint64_t key, int width, int height, const unsigned char* pixels) {
+    if (width <= 0 || height <= 0 || width > (int)MAX_SIDE || height > (int)MAX_SIDE) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!reopenIfReplaced()) {
+        return false;
+    }
+
+    uint64_t size = tileBytes(width, height);
+    bool ok = writeAll(packFd, pixels, size);
+    // O_APPEND put the tile at the end, wherever other processes left it
+    off_t end = ok ? lseek(packFd, 0, SEEK_CUR) : -1;
+    ok = end >= (off_t)size && writeRecord(key, end - size, width, height);
+    flock(indexFd, LOCK_UN);
+    if (!ok) {
+        debug::log(WARN, "Failed to append to thumbnail pack {}: {}", packPath, strerror(errno));
+        return false;
+    }
+
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        live -= tileBytes(it->second.width, it->second.height);
+    }
+    entries[key] = {uint64_t(end) - size, uint32_t(width), uint32_t(height), false};
+    live += size;
+    total += size;
+    return true;
+}
+
+void ThumbnailPack::remove(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+    live -= tileBytes(it->second.width, it->second.height);
+    entries.erase(it);
+
+    if (reopenIfReplaced()) {
+        writeRecord(key, REMOVED, 0, 0);
+        flock(indexFd, LOCK_UN);
+    }
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> ThumbnailPack::tiles() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<uint64_t, uint64_t>> out;
+    for (const auto& [key, e] : entries) {
+        out.emplace_back(key, tileBytes(e.width, e.height));
+    }
+    return out;
+}
+
+uint64_t ThumbnailPack::liveBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return live;
+}
+
+uint64_t ThumbnailPack::staleBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total - live;
+}
+
+bool ThumbnailPack::compactIfNeeded() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t stale = total - live;
+        if (indexFd < 0 || stale < COMPACT_MIN || stale < total * COMPACT_RATIO) {
+            return false;
+        }
+    }
+    return compact();
+}
+
+// works on its own descriptors and without the mutex, so lookups and this process's
+// appends only wait for it at the file lock
+bool ThumbnailPack::compact() {
+    int pack, index;
+    if (!openPair(packPath, indexPath, LOCK_EX, pack, index)) {
+        return false;
+    }
+
+    // what is on disk now, other processes may have appended or compacted since we opened
+    struct stat st;
+    uint64_t packSize = fstat(pack, &st) == 0 ? st.st_size : 0;
+    uint64_t packId, indexId;
+    void* source = MAP_FAILED;
+    if (packSize > sizeof(FileHeader) && readHeader(pack, PACK_MAGIC, packId) &&
+        readHeader(index, INDEX_MAGIC, indexId) && packId == indexId) {
+        source = mmap(nullptr, packSize, PROT_READ, MAP_SHARED, pack, 0);
+    }
+    if (source == MAP_FAILED) {
+        closePair(pack, index);
+        return false;
+    }
+
+    // the live tiles in pack order, so the old one is read front to back
+    std::vector<IndexRecord> records;
+    uint64_t keep = 0;
+    for (const auto& [key, r] : readIndex(index, packSize)) {
+        records.push_back(r);
+        keep += tileBytes(r.width, r.height);
+    }
+    std::sort(records.begin(), records.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+    std::vector<const unsigned char*> pixels;
+    for (const auto& r : records) {
+        pixels.push_back(static_cast<const unsigned char*>(source) + r.offset);
+    }
+
+    uint64_t before = packSize - sizeof(FileHeader);
+    bool ok = false;
+    if (before - keep >= COMPACT_MIN && before - keep >= before * COMPACT_RATIO) {
+        ok = replacePair(packPath, indexPath, pixels, std::move(records));
+        if (ok) {
+            debug::log(DEBUG, "Compacted thumbnail pack {} from {} to {} bytes", packPath, before, keep);
+        } else {
+            debug::log(WARN, "Failed to compact thumbnail pack {}: {}", packPath, strerror(errno));
+        }
+    }
+    munmap(source, packSize);
+    closePair(pack, index);
+
+    // this process's appends find the new files through reopenIfReplaced
+    std::lock_guard<std::mutex> lock(mutex);
+    total = ok ? keep : before;
+    live = keep;
+    return ok;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// thumbnails as raw RGBA tiles appended to one file, with a second file indexing them by
+// key. the tiles are mapped read-only, so a cached thumbnail goes to the GPU straight
+// from the page cache instead of through a png decode.
+//
+// both files are append-only: a tile is written first and then its index record, so a
+// crash leaves at worst an unindexed tile. a tile that is replaced or removed stays in
+// the pack as stale bytes until compactIfNeeded() rewrites it. several hyprwat
+// processes may use the pack at once, appends hold a shared flock on the index and
+// compaction an exclusive one
+class ThumbnailPack {
+public:
+    // compact once stale tiles are more than this much of the pack, and at least COMPACT_MIN
+    static constexpr double COMPACT_RATIO = 0.25;
+    static constexpr uint64_t COMPACT_MIN = 16 << 20;
+
+    struct Tile {
+        int width = 0;
+        int height = 0;
+        const unsigned char* pixels = nullptr; // in the mapping, valid for the pack's lifetime
+    };
+
+    // dir/name.pack and dir/name.index, created if missing
+    ThumbnailPack(const std::string& dir, const std::string& name);
+    ~ThumbnailPack();
+
+    ThumbnailPack(const ThumbnailPack&) = delete;
+    ThumbnailPack& operator=(const ThumbnailPack&) = delete;
+
+    // the tile stored under key when the pack was opened
+    bool find(uint64_t key, Tile& out);
+
+    // store width x height RGBA pixels under key, for the next run to find
+    bool append(uint64_t key, int width, int height, const unsigned char* pixels);
+
+    // drop key's tile, leaving its bytes stale
+    void remove(uint64_t key);
+
+    // rewrite the pack without its stale tiles if there are enough of them. tiles found
+    // earlier stay valid, they point into the old mapping
+    bool compactIfNeeded();
+
+    // the key and size in bytes of every tile
+    std::vector<std::pair<uint64_t, uint64_t>> tiles();
+
+    uint64_t liveBytes();
+    uint64_t staleBytes();
+
+private:
+    struct Entry {
+        uint64_t offset;
+        uint32_t width;
+        uint32_t height;
+        bool mapped; // in the mapping made on open, not appended since
+    };
+
+    std::string packPath;
+    std::string indexPath;
+    std::mutex mutex;
+    int packFd = -1;
+    int indexFd = -1;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t live = 0;  // bytes of the tiles in entries
+    uint64_t total = 0; // bytes of all tiles in the pack
+
+    bool reopenIfReplaced();
+    bool writeRecord(uint64_t key, uint64_t offset, uint32_t width, uint32_t height);
+    bool compact();
+};
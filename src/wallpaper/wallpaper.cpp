@@ -1,42 +1,240 @@
 #include "wallpaper.hpp"
 #include "../debug/log.hpp"
+#include "../debug/stats.hpp"
+#include "../debug/trace.hpp"
+#include "../util.hpp"
 #include <algorithm>
-#include <filesystem>
-
-namespace fs = std::filesystem;
+#include <chrono>
+#include <format>
 
 std::string getCacheDir() {
-    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME")) {
-        return std::string(xdgCache) + "/hyprwat/wallpapers/";
+    std::string dir = cachePath("wallpapers/");
+    if (dir.empty()) {
+        throw std::runtime_error("Neither XDG_CACHE_HOME nor HOME is set");
     }
+    return dir;
+}
 
-    const char* home = std::getenv("HOME");
-    if (!home) {
-        throw std::runtime_error("Neither XDG_CACHE_HOME nor HOME is set");
+WallpaperManager::~WallpaperManager() { stop(); }
+
+void WallpaperManager::scan() {
+    wallpaperIndex.load();
+    wallpapers = wallpaperIndex.scan(wallpaperDir, wallpaperExts);
+    std::sort(wallpapers.begin(), wallpapers.end(), [](auto const& a, auto const& b) {
+        return a.modifiedNs > b.modifiedNs;
+    });
+
+    // thumbnails of wallpapers that were replaced or deleted
+    for (uint64_t key : wallpaperIndex.takeOrphans()) {
+        thumbnailCache.forget(key);
     }
+    wallpaperIndex.save();
+}
 
-    return std::string(home) + "/.cache/hyprwat/wallpapers/";
+void WallpaperManager::generateThumbnails(int width, int height, ThumbnailCallback cb) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || wallpapers.empty()) {
+        return;
+    }
+    for (int i = 0; i < (int)wallpapers.size(); ++i) {
+        pending.insert(i);
+    }
+    thumbKeys.assign(wallpapers.size(), 0);
+
+    // decoding is the slow part, it gets every core. the writer mostly waits on them.
+    // full-size decodes share DECODE_BUDGET_BYTES, so many cores don't mean many 8K images
+    int n = std::clamp((int)std::thread::hardware_concurrency(), 1, (int)wallpapers.size());
+    working = n;
+    for (int i = 0; i < n; ++i) {
+        workers.emplace_back([this, width, height, cb] { work(width, height, cb); });
+    }
+    writer = std::thread(&WallpaperManager::write, this);
 }
 
-void WallpaperManager::loadWallpapers() {
-    wallpapers.clear();
-    try {
-        for (const auto& entry : fs::recursive_directory_iterator(wallpaperDir)) {
-            if (fs::is_regular_file(entry.path())) {
-                // only add images
-                if (wallpaperExts.contains(entry.path().extension().string())) {
-                    debug::log(DEBUG, "Adding wallpaper: {}", entry.path().string());
-                    wallpapers.push_back({entry.path().string(),
-                                          thumbnailCache.getOrCreateThumbnail(entry.path().string(), 400, 225),
-                                          fs::last_write_time(entry.path())});
-                }
-            } else if (fs::is_directory(entry.path())) {
-                debug::log(DEBUG, "Found directory: {}", entry.path().string());
+void WallpaperManager::focus(int index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    focused = index;
+}
+
+void WallpaperManager::stop() {
+    std::vector<std::thread> running;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        if (!pending.empty() || !writes.empty()) {
+            debug::log(DEBUG, "Cancelled {} thumbnails and {} cache writes", pending.size(), writes.size());
+        }
+        pending.clear();
+        writes.clear();
+        running.swap(workers);
+    }
+    written.notify_all();
+    for (auto& t : running) {
+        t.join();
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void WallpaperManager::work(int width, int height, const ThumbnailCallback& cb) {
+    debug::trace::setThreadName("thumbnailer");
+    auto& generated = debug::stats::histogram("thumbnail generate");
+
+    while (true) {
+        int index;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || pending.empty()) {
+                break;
+            }
+            // the nearest one to the focus, ahead of it on a tie
+            auto it = pending.lower_bound(focused);
+            if (it == pending.end() || (it != pending.begin() && focused - *std::prev(it) < *it - focused)) {
+                --it;
             }
+            index = *it;
+            pending.erase(it);
+        }
+
+        const std::string& path = wallpapers[index].path;
+        uint64_t key = ThumbnailCache::thumbnailKey(wallpapers[index].key, width, height);
+
+        Thumbnail thumb;
+        if (thumbnailCache.load(key, thumb)) {
+            cb(index, thumb);
+            std::lock_guard<std::mutex> lock(mutex);
+            thumbKeys[index] = key;
+            ++hits;
+            continue;
+        }
+
+        debug::trace::Span span("thumbnail");
+        debug::stats::Timer timer(generated);
+        if (!thumbnailCache.generate(path, width, height, thumb)) {
+            debug::log(ERR, "Failed to create a thumbnail for {}", path);
+            continue;
+        }
+        cb(index, thumb);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stopping) {
+            thumbKeys[index] = key;
+            ++made;
+            writes.emplace_back(key, std::move(thumb));
+            written.notify_one();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--working == 0) {
+        written.notify_one();
+    }
+}
+
+void WallpaperManager::write() {
+    debug::trace::setThreadName("thumbnail-writer");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        written.wait(lock, [this] { return stopping || working == 0 || !writes.empty(); });
+        if (writes.empty()) {
+            break; // stopped, or the workers are done and so is everything they made
+        }
+        auto [key, thumb] = std::move(writes.front());
+        writes.pop_front();
+
+        lock.unlock();
+        thumbnailCache.save(key, thumb);
+        lock.lock();
+    }
+
+    // only the writer uses the index now. remember which thumbnails were shown even when
+    // stopped early, so the next run starts from them and eviction knows they are fresh
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+    std::unordered_set<uint64_t> shown;
+    for (size_t i = 0; i < wallpapers.size(); ++i) {
+        if (thumbKeys[i]) {
+            wallpaperIndex.setThumbnail(wallpapers[i].path, thumbKeys[i], now.count());
+            shown.insert(thumbKeys[i]);
+        }
+    }
+    int hitCount = hits, madeCount = made;
+    lock.unlock();
+
+    wallpaperIndex.prune(wallpaperDir);
+    for (uint64_t key : wallpaperIndex.takeOrphans()) {
+        thumbnailCache.forget(key);
+    }
+    evict(shown);
+    wallpaperIndex.save();
+
+    if (debug::stats::enabled && hitCount + madeCount > 0) {
+        debug::stats::note("thumbnail cache",
+                           std::format("{} of {} hits ({:.0f}%), {:.1f} of {} MB",
+                                       hitCount,
+                                       hitCount + madeCount,
+                                       100.0 * hitCount / (hitCount + madeCount),
+                                       thumbnailCache.size() / 1048576.0,
+                                       cacheBudget.load() >> 20));
+    }
+}
+
+void WallpaperManager::evict(const std::unordered_set<uint64_t>& shown) {
+    // anything the index doesn't know is garbage: made by a run that crashed before
+    // saving it, or under an older key scheme
+    auto used = wallpaperIndex.thumbnails();
+    struct Candidate {
+        int64_t lastUsed;
+        uint64_t key;
+        uint64_t bytes;
+    };
+    std::vector<Candidate> candidates;
+    uint64_t size = 0;
+    int garbage = 0;
+    for (auto [key, bytes] : thumbnailCache.thumbnails()) {
+        auto it = used.find(key);
+        if (it == used.end()) {
+            thumbnailCache.forget(key);
+            ++garbage;
+            continue;
+        }
+        size += bytes;
+        if (!shown.contains(key)) {
+            candidates.push_back({it->second, key, bytes});
+        }
+    }
+
+    // then the least recently shown until it fits. this run's thumbnails stay, a
+    // directory bigger than the budget is over it rather than made again every time
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    uint64_t budget = cacheBudget;
+    std::unordered_set<uint64_t> evicted;
+    for (const auto& c : candidates) {
+        if (size <= budget) {
+            break;
+        }
+        thumbnailCache.forget(c.key);
+        evicted.insert(c.key);
+        size -= c.bytes;
+    }
+    wallpaperIndex.forgetThumbnails(evicted);
+
+    if (garbage > 0 || !evicted.empty()) {
+        debug::log(
+            DEBUG, "Dropped {} unused and evicted {} thumbnails, {} bytes cached", garbage, evicted.size(), size);
+    }
+}
+
+void WallpaperManager::compactCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
         }
-        std::sort(
-            wallpapers.begin(), wallpapers.end(), [](auto const& a, auto const& b) { return a.modified > b.modified; });
-    } catch (const fs::filesystem_error& e) {
-        debug::log(ERR, "Filesystem error while loading wallpapers: {}", e.what());
     }
+    thumbnailCache.removeLegacyFiles();
+    thumbnailCache.compact();
 }
@@ -1,28 +1,81 @@
 #pragma once
 
 #include "thumbnail.hpp"
+#include "wallpaper_index.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 std::string getCacheDir();
 
-struct Wallpaper {
-    std::string path;
-    std::string thumbnailPath;
-    std::filesystem::file_time_type modified;
-};
+using Wallpaper = IndexedFile;
 
+// finds the wallpapers, then makes their thumbnails in a pipeline: every core decodes
+// and shrinks (or loads a cached one), nearest the focused wallpaper first, and one
+// more thread writes the new ones to the cache. each thumbnail is handed over as soon
+// as it is ready instead of after the whole directory
 class WallpaperManager {
 
 public:
-    WallpaperManager(const std::string& wallpaperDir) : wallpaperDir(wallpaperDir), thumbnailCache(getCacheDir()) {}
-    void loadWallpapers();
+    // the thumbnail for getWallpapers()[index], called on a worker thread
+    using ThumbnailCallback = std::function<void(int index, const Thumbnail& thumb)>;
+
+    WallpaperManager(const std::string& wallpaperDir)
+        : wallpaperDir(wallpaperDir), thumbnailCache(getCacheDir()),
+          wallpaperIndex(getCacheDir() + "wallpapers.index") {}
+    ~WallpaperManager();
+
+    // find the wallpapers, newest first. their thumbnails come from generateThumbnails
+    void scan();
     const std::vector<Wallpaper>& getWallpapers() const { return wallpapers; }
 
+    // start making a width x height thumbnail for every scanned wallpaper
+    void generateThumbnails(int width, int height, ThumbnailCallback cb);
+
+    // the wallpapers around index are wanted next
+    void focus(int index);
+
+    // drop the queued work, wait for what is in flight. safe before generateThumbnails
+    void stop();
+
+    // bytes of thumbnails to keep. checked when the thumbnails are done, the least
+    // recently shown ones beyond it are evicted
+    static constexpr uint64_t DEFAULT_CACHE_BUDGET = 256ull << 20;
+    void setCacheBudget(uint64_t bytes) { cacheBudget = bytes; }
+
+    // reclaim the space of evicted thumbnails and delete an older version's pngs. slow
+    // when there is something to do, meant for a background thread
+    void compactCache();
+
 private:
     std::string wallpaperDir;
     std::vector<Wallpaper> wallpapers;
     ThumbnailCache thumbnailCache;
+    WallpaperIndex wallpaperIndex; // the loader thread's until the workers are done, then the writer's
     const std::set<std::string> wallpaperExts = {".jpg", ".png", ".jpeg", ".bmp", ".gif"};
+
+    std::mutex mutex;
+    std::condition_variable written;                   // wakes the writer
+    std::set<int> pending;                             // indices not started yet
+    std::vector<uint64_t> thumbKeys;                   // per wallpaper, 0 until it has one
+    std::deque<std::pair<uint64_t, Thumbnail>> writes; // new thumbnails for the cache
+    int focused = 0;
+    int working = 0; // workers still running
+    int hits = 0;    // thumbnails found in the cache
+    int made = 0;    // and the ones that weren't
+    bool stopping = false;
+    std::vector<std::thread> workers;
+    std::thread writer;
+    std::atomic<uint64_t> cacheBudget = DEFAULT_CACHE_BUDGET;
+
+    void work(int width, int height, const ThumbnailCallback& cb);
+    void write();
+    void evict(const std::unordered_set<uint64_t>& shown);
 };
@@ -0,0 +1,387 @@
+#include "wallpaper_index.hpp"
+#include "../debug/log.hpp"
+#include "../util.hpp"
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+
+// an index starting with anything else is ignored and rebuilt by the next scan
+static constexpr char MAGIC[8] = {'H', 'W', 'W', 'P', 'I', 'D', 'X', '2'};
+
+// a directory changed less than this long ago may still change within the same mtime
+// tick, it is read again next time instead of trusted
+static constexpr int64_t RACY_NS = 2'000'000'000;
+
+static int64_t mtimeNs(const struct stat& st) {
+    return int64_t(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+}
+
+static std::string join(const std::string& dir, const char* name) { return dir == "/" ? dir + name : dir + "/" + name; }
+
+static std::string withoutSlash(std::string root) {
+    while (root.size() > 1 && root.back() == '/') {
+        root.pop_back();
+    }
+    return root;
+}
+
+static bool isUnder(const std::string& path, const std::string& root) {
+    return path == root || path.starts_with(root == "/" ? root : root + "/");
+}
+
+static std::string extension(const char* name) {
+    const char* dot = strrchr(name, '.');
+    return dot && dot != name ? dot : "";
+}
+
+// the index file is a flat sequence of these, in host byte order like the thumbnail pack
+struct Writer {
+    std::ostream& out;
+
+    template <typename T> void put(T value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void put(const std::string& s) {
+        put(uint32_t(s.size()));
+        out.write(s.data(), s.size());
+    }
+};
+
+struct Reader {
+    const std::vector<char>& data;
+    size_t pos = 0;
+    bool ok = true;
+
+    template <typename T> T get() {
+        T value{};
+        if (pos + sizeof(T) > data.size()) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    std::string getString() {
+        uint32_t size = get<uint32_t>();
+        if (!ok || pos + size > data.size()) {
+            ok = false;
+            return {};
+        }
+        pos += size;
+        return std::string(data.data() + pos - size, size);
+    }
+};
+
+void WallpaperIndex::load() {
+    dirs.clear();
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        return;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        debug::log(WARN, "Ignoring unreadable wallpaper index {}", file);
+        return;
+    }
+
+    Reader r{data, sizeof(MAGIC)};
+    uint32_t dirCount = r.get<uint32_t>();
+    for (uint32_t d = 0; r.ok && d < dirCount; ++d) {
+        std::string path = r.getString();
+        DirRecord rec;
+        rec.modifiedNs = r.get<int64_t>();
+        uint32_t fileCount = r.get<uint32_t>();
+        for (uint32_t f = 0; r.ok && f < fileCount; ++f) {
+            FileRecord fr;
+            fr.name = r.getString();
+            fr.inode = r.get<uint64_t>();
+            fr.size = r.get<uint64_t>();
+            fr.modifiedNs = r.get<int64_t>();
+            fr.key = r.get<uint64_t>();
+            fr.thumbKey = r.get<uint64_t>();
+            fr.lastUsed = r.get<int64_t>();
+            rec.files.push_back(std::move(fr));
+        }
+        uint32_t subdirCount = r.get<uint32_t>();
+        for (uint32_t s = 0; r.ok && s < subdirCount; ++s) {
+            rec.subdirs.push_back(r.getString());
+        }
+        dirs[path] = std::move(rec);
+    }
+    if (!r.ok) {
+        debug::log(WARN, "Ignoring damaged wallpaper index {}", file);
+        dirs.clear();
+    }
+}
+
+void WallpaperIndex::save() {
+    if (!dirty) {
+        return;
+    }
+    // another instance never reads half of it
+    bool written = writeFileAtomically(file, [&](std::ostream& out) {
+        Writer w{out};
+        out.write(MAGIC, sizeof(MAGIC));
+        w.put(uint32_t(dirs.size()));
+        for (const auto& [path, rec] : dirs) {
+            w.put(path);
+            w.put(rec.modifiedNs);
+            w.put(uint32_t(rec.files.size()));
+            for (const auto& f : rec.files) {
+                w.put(f.name);
+                w.put(f.inode);
+                w.put(f.size);
+                w.put(f.modifiedNs);
+                w.put(f.key);
+                w.put(f.thumbKey);
+                w.put(f.lastUsed);
+            }
+            w.put(uint32_t(rec.subdirs.size()));
+            for (const auto& s : rec.subdirs) {
+                w.put(s);
+            }
+        }
+    });
+    if (!written) {
+        debug::log(WARN, "Failed to write wallpaper index {}", file);
+        return;
+    }
+    dirty = false;
+}
+
+void WallpaperIndex::read(const std::string& path,
+                          const DirRecord* old,
+                          const std::set<std::string>& exts,
+                          DirRecord& out) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        debug::log(ERR, "Failed to read wallpaper directory {}: {}", path, strerror(errno));
+        return;
+    }
+
+    std::unordered_map<std::string, const FileRecord*> known;
+    if (old) {
+        for (const auto& f : old->files) {
+            known[f.name] = &f;
+        }
+    }
+
+    while (dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        // like recursive_directory_iterator: symlinked images count, symlinked directories
+        // aren't followed
+        if (entry->d_type == DT_DIR) {
+            out.subdirs.push_back(name);
+            continue;
+        }
+        if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+            continue;
+        }
+        std::string child = join(path, name);
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat lst;
+            if (lstat(child.c_str(), &lst) == 0 && S_ISDIR(lst.st_mode)) {
+                out.subdirs.push_back(name);
+                continue;
+            }
+        }
+        if (!exts.contains(extension(name))) {
+            continue;
+        }
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        FileRecord rec{name, uint64_t(st.st_ino), uint64_t(st.st_size), mtimeNs(st), 0, 0, 0};
+        auto it = known.find(rec.name);
+        if (it != known.end() && it->second->inode == rec.inode && it->second->size == rec.size &&
+            it->second->modifiedNs == rec.modifiedNs) {
+            rec.key = it->second->key;
+            rec.thumbKey = it->second->thumbKey;
+            rec.lastUsed = it->second->lastUsed;
+            known.erase(it);
+        } else {
+            rec.key = FNV_OFFSET;
+            hashMix(rec.key, child.data(), child.size());
+            hashMix(rec.key, uint64_t(st.st_dev));
+            hashMix(rec.key, rec.inode);
+            hashMix(rec.key, rec.size);
+            hashMix(rec.key, rec.modifiedNs);
+            rec.key = rec.key ? rec.key : 1;
+        }
+        out.files.push_back(std::move(rec));
+    }
+    closedir(dir);
+
+    // whatever is left was replaced or deleted
+    for (const auto& [name, f] : known) {
+        if (f->thumbKey) {
+            orphans.push_back(f->thumbKey);
+        }
+    }
+}
+
+std::vector<IndexedFile> WallpaperIndex::scan(const std::string& rootPath, const std::set<std::string>& exts) {
+    dirsRead = dirsSkipped = 0;
+    std::string root = withoutSlash(rootPath);
+
+    auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch).count();
+
+    std::vector<IndexedFile> found;
+    std::unordered_map<std::string, DirRecord> seen;
+    std::vector<std::string> stack{root};
+    while (!stack.empty()) {
+        std::string path = std::move(stack.back());
+        stack.pop_back();
+        struct stat st;
+        if (seen.contains(path) || stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            continue;
+        }
+
+        DirRecord rec;
+        int64_t modified = mtimeNs(st);
+        auto old = dirs.find(path);
+        if (old != dirs.end() && old->second.modifiedNs != 0 && old->second.modifiedNs == modified) {
+            rec = std::move(old->second);
+            ++dirsSkipped;
+        } else {
+            read(path, old != dirs.end() ? &old->second : nullptr, exts, rec);
+            rec.modifiedNs = now - modified < RACY_NS ? 0 : modified;
+            dirty = true;
+            ++dirsRead;
+        }
+
+        for (const auto& f : rec.files) {
+            found.push_back({join(path, f.name.c_str()), f.modifiedNs, f.key});
+        }
+        for (const auto& s : rec.subdirs) {
+            stack.push_back(join(path, s.c_str()));
+        }
+        seen[path] = std::move(rec);
+    }
+
+    // directories under root that are gone take their thumbnails with them
+    for (auto it = dirs.begin(); it != dirs.end();) {
+        if (!isUnder(it->first, root)) {
+            ++it;
+            continue;
+        }
+        if (!seen.contains(it->first)) {
+            for (const auto& f : it->second.files) {
+                if (f.thumbKey) {
+                    orphans.push_back(f.thumbKey);
+                }
+            }
+            dirty = true;
+        }
+        it = dirs.erase(it);
+    }
+    dirs.merge(seen);
+
+    debug::log(DEBUG,
+               "Scanned {} wallpapers, read {} directories and took {} from the index",
+               found.size(),
+               dirsRead,
+               dirsSkipped);
+    return found;
+}
+
+void WallpaperIndex::setThumbnail(const std::string& path, uint64_t thumbKey, int64_t now) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return;
+    }
+    auto dir = dirs.find(slash == 0 ? "/" : path.substr(0, slash));
+    if (dir == dirs.end()) {
+        return;
+    }
+    for (auto& f : dir->second.files) {
+        if (f.name == path.substr(slash + 1)) {
+            // a thumbnail of another size, nothing will ask for it again
+            if (f.thumbKey && f.thumbKey != thumbKey) {
+                orphans.push_back(f.thumbKey);
+            }
+            f.thumbKey = thumbKey;
+            f.lastUsed = now;
+            dirty = true;
+            return;
+        }
+    }
+}
+
+std::unordered_map<uint64_t, int64_t> WallpaperIndex::thumbnails() const {
+    std::unordered_map<uint64_t, int64_t> used;
+    for (const auto& [path, dir] : dirs) {
+        for (const auto& f : dir.files) {
+            if (f.thumbKey) {
+                used[f.thumbKey] = f.lastUsed;
+            }
+        }
+    }
+    return used;
+}
+
+void WallpaperIndex::forgetThumbnails(const std::unordered_set<uint64_t>& thumbKeys) {
+    if (thumbKeys.empty()) {
+        return;
+    }
+    for (auto& [path, dir] : dirs) {
+        for (auto& f : dir.files) {
+            if (thumbKeys.contains(f.thumbKey)) {
+                f.thumbKey = 0;
+                dirty = true;
+            }
+        }
+    }
+}
+
+void WallpaperIndex::prune(const std::string& rootPath) {
+    std::string root = withoutSlash(rootPath);
+    for (auto it = dirs.begin(); it != dirs.end();) {
+        auto& [path, dir] = *it;
+        if (isUnder(path, root)) {
+            ++it;
+            continue;
+        }
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            for (const auto& f : dir.files) {
+                if (f.thumbKey) {
+                    orphans.push_back(f.thumbKey);
+                }
+            }
+            it = dirs.erase(it);
+            dirty = true;
+            continue;
+        }
+        if (dir.modifiedNs == 0 || dir.modifiedNs != mtimeNs(st)) {
+            std::erase_if(dir.files, [&](const FileRecord& f) {
+                struct stat fst;
+                std::string child = join(path, f.name.c_str());
+                if (stat(child.c_str(), &fst) == 0 && uint64_t(fst.st_ino) == f.inode &&
+                    uint64_t(fst.st_size) == f.size && mtimeNs(fst) == f.modifiedNs) {
+                    return false;
+                }
+                if (f.thumbKey) {
+                    orphans.push_back(f.thumbKey);
+                }
+                dirty = true;
+                return true;
+            });
+        }
+        ++it;
+    }
+}
+
+std::vector<uint64_t> WallpaperIndex::takeOrphans() {
+    std::vector<uint64_t> taken;
+    taken.swap(orphans);
+    return taken;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// a wallpaper file as the index last saw it
+struct IndexedFile {
+    std::string path;
+    int64_t modifiedNs;
+    uint64_t key; // changes whenever the file does
+};
+
+// what the wallpaper directories looked like on the last run, kept in the cache so a
+// warm start neither walks nor stats what hasn't changed. for every directory it has
+// the mtime and its wallpapers (inode, size, mtime and key) and subdirectories. a
+// directory whose mtime still matches is taken from the index without reading it;
+// files only get a new key when they were added, replaced or touched.
+//
+// a file edited in place doesn't change its directory's mtime, so its old thumbnail is
+// kept until something else in that directory changes
+class WallpaperIndex {
+public:
+    explicit WallpaperIndex(const std::string& file) : file(file) {}
+
+    // read the saved index, an unreadable one is started over
+    void load();
+
+    // write it back if scan or setThumbnail changed anything
+    void save();
+
+    // every wallpaper under root with one of exts, unchanged directories from the index
+    std::vector<IndexedFile> scan(const std::string& root, const std::set<std::string>& exts);
+
+    // the cached thumbnail of the file at path, shown at now (seconds)
+    void setThumbnail(const std::string& path, uint64_t thumbKey, int64_t now);
+
+    // every thumbnail the index knows, with when it was last shown
+    std::unordered_map<uint64_t, int64_t> thumbnails() const;
+
+    // the cache evicted these
+    void forgetThumbnails(const std::unordered_set<uint64_t>& thumbKeys);
+
+    // drop what is recorded outside root but no longer exists. directories whose mtime
+    // is unchanged are trusted, the others have their files looked up again
+    void prune(const std::string& root);
+
+    // thumbnails of files that changed or went away since the last scan, to be dropped
+    std::vector<uint64_t> takeOrphans();
+
+    // directories the last scan read, and the ones it took from the index
+    int dirsRead = 0;
+    int dirsSkipped = 0;
+
+private:
+    struct FileRecord {
+        std::string name;
+        uint64_t inode;
+        uint64_t size;
+        int64_t modifiedNs;
+        uint64_t key;
+        uint64_t thumbKey; // 0 until one is made
+        int64_t lastUsed;  // when thumbKey was last shown, in seconds
+    };
+
+    struct DirRecord {
+        int64_t modifiedNs; // 0 forces a read next time
+        std::vector<FileRecord> files;
+        std::vector<std::string> subdirs;
+    };
+
+    std::string file;
+    std::unordered_map<std::string, DirRecord> dirs; // by path
+    std::vector<uint64_t> orphans;
+    bool dirty = false;
+
+    // list path into out, keeping the keys and thumbnails of files that old already had
+    void read(const std::string& path, const DirRecord* old, const std::set<std::string>& exts, DirRecord& out);
+};
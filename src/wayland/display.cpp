@@ -76,6 +76,10 @@ namespace wl {
 
     void Display::readEvents() { wl_display_read_events(display_); }
 
+    void Display::cancelRead() { wl_display_cancel_read(display_); }
+
+    int Display::fd() const { return wl_display_get_fd(display_); }
+
     void Display::flush() { wl_display_flush(display_); }
 
     void Display::registryHandler(
@@ -31,8 +31,12 @@ namespace wl {
         void roundtrip();
         void prepareRead();
         void readEvents();
+        void cancelRead();
         void flush();
 
+        // connection fd, for polling alongside other event sources
+        int fd() const;
+
         wl_display* display() const { return display_; }
         wl_compositor* compositor() const { return compositor_; }
         zwlr_layer_shell_v1* layerShell() const { return layerShell_; }
@@ -1,8 +1,10 @@
 #include "input.hpp"
+#include "../redraw.hpp"
 
 extern "C" {
 #include <linux/input-event-codes.h>
 }
+#include <algorithm>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -181,6 +183,7 @@ namespace wl {
     void InputHandler::pointerEnter(void* data, wl_pointer*, uint32_t, wl_surface*, wl_fixed_t sx, wl_fixed_t sy) {
         InputHandler* self = static_cast<InputHandler*>(data);
         self->io->MousePos = ImVec2((float)wl_fixed_to_int(sx), (float)wl_fixed_to_int(sy));
+        redraw::request();
     }
 
     void InputHandler::pointerLeave(void*, wl_pointer*, uint32_t, wl_surface*) {}
@@ -188,6 +191,7 @@ namespace wl {
     void InputHandler::pointerMotion(void* data, wl_pointer*, uint32_t, wl_fixed_t sx, wl_fixed_t sy) {
         InputHandler* self = static_cast<InputHandler*>(data);
         self->io->MousePos = ImVec2((float)wl_fixed_to_int(sx), (float)wl_fixed_to_int(sy));
+        redraw::request();
     }
 
     void InputHandler::pointerButton(void* data, wl_pointer*, uint32_t, uint32_t, uint32_t button, uint32_t state) {
@@ -195,6 +199,8 @@ namespace wl {
 
         // handle mouse state for ImGui
         bool pressed = (state == WL_POINTER_BUTTON_STATE_PRESSED);
+        self->buttonsDown = std::max(0, self->buttonsDown + (pressed ? 1 : -1));
+        redraw::request();
         if (button == BTN_LEFT)
             self->io->MouseDown[0] = pressed;
         else if (button == BTN_RIGHT)
@@ -216,6 +222,7 @@ namespace wl {
             self->io->MouseWheel += wl_fixed_to_double(value);
         if (axis == WL_POINTER_AXIS_HORIZONTAL_SCROLL)
             self->io->MouseWheelH += wl_fixed_to_double(value);
+        redraw::request();
     }
 
     void InputHandler::pointerFrame(void*, wl_pointer*) {}
@@ -228,6 +235,7 @@ namespace wl {
             self->io->MouseWheel += (float)discrete;
         if (axis == WL_POINTER_AXIS_HORIZONTAL_SCROLL)
             self->io->MouseWheelH += (float)discrete;
+        redraw::request();
     }
 
     void InputHandler::keyboardKeymap(void* data, wl_keyboard*, uint32_t format, int32_t fd, uint32_t size) {
@@ -284,13 +292,16 @@ namespace wl {
         if (!self->io)
             return;
         self->io->AddFocusEvent(true);
+        redraw::request();
     }
 
     void InputHandler::keyboardLeave(void* data, wl_keyboard*, uint32_t, wl_surface*) {
         InputHandler* self = static_cast<InputHandler*>(data);
+        self->keysDown = 0;
         if (!self->io)
             return;
         self->io->AddFocusEvent(false);
+        redraw::request();
     }
 
     void InputHandler::keyboardKey(void* data, wl_keyboard*, uint32_t, uint32_t, uint32_t key, uint32_t state) {
@@ -301,6 +312,8 @@ namespace wl {
         // key events are passed as evdev codes, which are offset by 8 from xkb codes
         xkb_keycode_t keycode = key + 8;
         bool pressed = (state == WL_KEYBOARD_KEY_STATE_PRESSED);
+        self->keysDown = std::max(0, self->keysDown + (pressed ? 1 : -1));
+        redraw::request();
 
         // update the key state in xkb
         if (self->state) {
@@ -341,6 +354,7 @@ namespace wl {
         self->io->KeyShift = shift;
         self->io->KeyAlt = alt;
         self->io->KeySuper = super;
+        redraw::request();
     }
 
     void InputHandler::keyboardRepeatInfo(void* data, wl_keyboard*, int32_t rate, int32_t delay) {
@@ -24,6 +24,16 @@ namespace wl {
 
         void setWindowBounds(int width, int height);
         bool shouldExit() const { return shouldExit_; }
+
+        // a key or mouse button is held down, so ImGui needs frames for key repeat and drags
+        bool isHeld() const { return keysDown > 0 || buttonsDown > 0; }
+
+        // forget the previous popup's state before showing a new one
+        void reset() {
+            shouldExit_ = false;
+            keysDown = 0;
+            buttonsDown = 0;
+        }
         void setIO(ImGuiIO* new_io) { io = new_io; }
 
     private:
@@ -34,6 +44,8 @@ namespace wl {
         int width = 0;
         int height = 0;
         bool shouldExit_ = false;
+        int keysDown = 0;
+        int buttonsDown = 0;
 
         // xkb state
         struct xkb_context* context = nullptr;
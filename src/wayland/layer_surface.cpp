@@ -1,10 +1,13 @@
 #include "layer_surface.hpp"
+#include "../redraw.hpp"
 
 namespace wl {
     LayerSurface::LayerSurface(wl_compositor* compositor, zwlr_layer_shell_v1* shell)
         : compositor(compositor), layerShell(shell) {}
 
     LayerSurface::~LayerSurface() {
+        if (frameCallback)
+            wl_callback_destroy(frameCallback);
         if (layerSurface)
             zwlr_layer_surface_v1_destroy(layerSurface);
         if (surface_)
@@ -15,6 +18,8 @@ namespace wl {
     void LayerSurface::create(int x, int y, int width, int height) {
         width_ = width;
         height_ = height;
+        requestedWidth_ = width;
+        requestedHeight_ = height;
 
         surface_ = wl_compositor_create_surface(compositor);
         layerSurface = zwlr_layer_shell_v1_get_layer_surface(
@@ -34,21 +39,22 @@ namespace wl {
         wl_surface_commit(surface_);
     }
 
-    // resize the layer surface and associated EGL window
-    void LayerSurface::resize(int newWidth, int newHeight, egl::Context& egl) {
-        width_ = newWidth;
-        height_ = newHeight;
+    // request a new size, the resize itself happens when the compositor configures us
+    void LayerSurface::requestSize(int newWidth, int newHeight) {
+        if (newWidth == requestedWidth_ && newHeight == requestedHeight_) {
+            return;
+        }
+        requestedWidth_ = newWidth;
+        requestedHeight_ = newHeight;
 
-        // Resize the layer surface
         zwlr_layer_surface_v1_set_size(layerSurface, newWidth, newHeight);
         wl_surface_commit(surface_);
+    }
 
-        // Resize the EGL window
-        if (egl.window()) {
-            const int bufW = newWidth * (scale_ > 0 ? scale_ : 1);
-            const int bufH = newHeight * (scale_ > 0 ? scale_ : 1);
-            wl_egl_window_resize(egl.window(), bufW, bufH, 0, 0);
-        }
+    bool LayerSurface::takeResize() {
+        bool resized = resized_;
+        resized_ = false;
+        return resized;
     }
 
     // set the buffer scale for hidpi support
@@ -62,19 +68,46 @@ namespace wl {
         void* data, zwlr_layer_surface_v1* layerSurface, uint32_t serial, uint32_t width, uint32_t height) {
         LayerSurface* self = static_cast<LayerSurface*>(data);
 
-        if (width > 0)
-            self->width_ = width;
-        if (height > 0)
-            self->height_ = height;
+        // 0 means the compositor leaves the size to us
+        int newWidth = width > 0 ? (int)width : self->requestedWidth_;
+        int newHeight = height > 0 ? (int)height : self->requestedHeight_;
+        if (newWidth != self->width_ || newHeight != self->height_) {
+            self->resized_ = true;
+        }
+        self->width_ = newWidth;
+        self->height_ = newHeight;
 
         zwlr_layer_surface_v1_ack_configure(layerSurface, serial);
-        wl_surface_commit(self->surface_);
+        // later configures are committed along with the next buffer, drawn at the new size
+        if (!self->configured) {
+            wl_surface_commit(self->surface_);
+        }
         self->configured = true;
+        redraw::request();
     }
 
     void LayerSurface::closedHandler(void* data, zwlr_layer_surface_v1*) {
         LayerSurface* self = static_cast<LayerSurface*>(data);
         self->shouldExit_ = true;
+        redraw::request();
+    }
+
+    void LayerSurface::requestFrame() {
+        if (frameCallback)
+            wl_callback_destroy(frameCallback);
+
+        static const wl_callback_listener listener = {.done = frameDone};
+        frameCallback = wl_surface_frame(surface_);
+        wl_callback_add_listener(frameCallback, &listener, this);
+        framePending_ = true;
+        frameRequested = std::chrono::steady_clock::now();
+    }
+
+    void LayerSurface::frameDone(void* data, wl_callback* callback, uint32_t) {
+        LayerSurface* self = static_cast<LayerSurface*>(data);
+        wl_callback_destroy(callback);
+        self->frameCallback = nullptr;
+        self->framePending_ = false;
     }
 
     // logical pixel coordinates
@@ -5,6 +5,7 @@ extern "C" {
 #include "protocols/wlr-layer-shell-unstable-v1-client-protocol.h"
 #include <wayland-client.h>
 }
+#include <chrono>
 
 namespace wl {
 
@@ -17,7 +18,21 @@ namespace wl {
         void create(int x, int y, int width, int height);
         bool isConfigured() const { return configured; }
         wl_surface* surface() const { return surface_; }
-        void resize(int newWidth, int newHeight, egl::Context& egl);
+
+        // ask the compositor for a new size. width()/height() keep the current size until the
+        // matching configure arrives, after which takeResize() returns true once
+        void requestSize(int newWidth, int newHeight);
+        bool takeResize();
+
+        // ask the compositor for a frame callback on the next commit; framePending() is true
+        // until it fires, i.e. until the compositor is ready for another frame
+        void requestFrame();
+        bool framePending() const { return framePending_; }
+
+        // how long the pending frame callback has been outstanding
+        std::chrono::steady_clock::duration frameAge() const {
+            return std::chrono::steady_clock::now() - frameRequested;
+        }
 
         void requestExit() { shouldExit_ = true; }
         bool shouldExit() const { return shouldExit_; }
@@ -37,6 +52,12 @@ namespace wl {
         zwlr_layer_surface_v1* layerSurface = nullptr;
         bool configured = false;
         bool shouldExit_ = false;
+        bool framePending_ = false;
+        bool resized_ = false;
+        int requestedWidth_ = 0;
+        int requestedHeight_ = 0;
+        wl_callback* frameCallback = nullptr;
+        std::chrono::steady_clock::time_point frameRequested;
         int width_ = 0;
         int height_ = 0;
         int32_t scale_ = 1;
@@ -44,5 +65,6 @@ namespace wl {
         static void configureHandler(
             void* data, zwlr_layer_surface_v1* layerSurface, uint32_t serial, uint32_t width, uint32_t height);
         static void closedHandler(void* data, zwlr_layer_surface_v1* layerSurface);
+        static void frameDone(void* data, wl_callback* callback, uint32_t time);
     };
 } // namespace wl